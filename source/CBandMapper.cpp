@@ -0,0 +1,213 @@
+//-----------------------------------------------------------------------------------------
+// Title:	Band Mapper
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#include "CBandMapper.h"
+#include <math.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BAND_SIMD_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BAND_SIMD_SSE2
+#endif
+
+static void weightedSum(const float* specL, const float* specR, const float* weights, int count, float& sumL, float& sumR);
+
+//! Main constructor
+CBandMapper::CBandMapper() :
+	layout(BAND_LAYOUT_LOG), numBands(1), minFreq(BAND_DEFAULT_MIN_FREQUENCY), fftSize(2), sampFreq(2), dirty(true),
+	weightStart(0), bandBin(0), weightValue(0)
+{
+	edges[0] = 0;
+	edges[1] = 1;
+}
+
+//! Destructor
+CBandMapper::~CBandMapper()
+{
+	delete[] weightStart;
+	delete[] bandBin;
+	delete[] weightValue;
+}
+
+//! Sets the band layout (custom layouts take numBands+1 ascending edge frequencies in Hz, others fall back to log)
+void CBandMapper::setLayout(int layout, int numBands, const float* edges)
+{
+	if(numBands < 1) numBands = 1;
+	if(numBands > BAND_MAX_BANDS) numBands = BAND_MAX_BANDS;
+	if(layout == BAND_LAYOUT_CUSTOM && !edges) layout = BAND_LAYOUT_LOG;
+	if(layout == BAND_LAYOUT_CUSTOM) {
+		if(edges[0] < 0) layout = BAND_LAYOUT_LOG;
+		for(int i=0; i<numBands; i++) if(!(edges[i+1] > edges[i])) layout = BAND_LAYOUT_LOG;
+	}
+	if(layout == BAND_LAYOUT_CUSTOM) {
+		for(int i=0; i<=numBands; i++) this->edges[i] = edges[i];
+	}
+	this->layout = layout;
+	this->numBands = numBands;
+	dirty = true;
+}
+
+//! Sets the lowest edge frequency used by generated layouts
+void CBandMapper::setMinFrequency(float minFreq)
+{
+	this->minFreq = minFreq;
+	dirty = true;
+}
+
+//! Sets the spectrum to map from (bins in the full fft and the sampling frequency)
+void CBandMapper::setSpectrum(int fftSize, unsigned int sampFreq)
+{
+	if(fftSize == this->fftSize && sampFreq == this->sampFreq) return;
+	this->fftSize = fftSize;
+	this->sampFreq = sampFreq;
+	dirty = true;
+}
+
+//! Gets the number of bands
+int CBandMapper::getNumBands() const
+{
+	return numBands;
+}
+
+//! Gets the band edge frequency in Hz (0 to numBands)
+float CBandMapper::getBandEdge(int index) const
+{
+	if(index < 0) return edges[0];
+	if(index > numBands) return edges[numBands];
+	return edges[index];
+}
+
+//! Maps the spectrum bins to bands (weighted average of the bins in each band)
+void CBandMapper::map(const float* spec, float* bands)
+{
+	if(dirty) build();
+	for(int b=0; b<numBands; b++) {
+		float unused;
+		weightedSum(spec + bandBin[b], spec + bandBin[b], weightValue + weightStart[b], weightStart[b+1] - weightStart[b], bands[b], unused);
+	}
+}
+
+//! Maps a pair of spectrums to bands in the same pass
+void CBandMapper::mapStereo(const float* specL, const float* specR, float* bandsL, float* bandsR)
+{
+	if(dirty) build();
+	for(int b=0; b<numBands; b++) {
+		weightedSum(specL + bandBin[b], specR + bandBin[b], weightValue + weightStart[b], weightStart[b+1] - weightStart[b], bandsL[b], bandsR[b]);
+	}
+}
+
+//! Calculates the band edges for generated layouts
+void CBandMapper::calcEdges()
+{
+	float maxFreq = (float)sampFreq/2.0f;
+	float lowFreq = (minFreq < maxFreq) ? minFreq : maxFreq/2.0f;
+	if(lowFreq <= 0) lowFreq = 1.0f;
+	for(int i=0; i<=numBands; i++) {
+		float per = (float)i/(float)numBands;
+		if(layout == BAND_LAYOUT_LINEAR) {
+			edges[i] = lowFreq + (maxFreq-lowFreq)*per;
+		} else if(layout == BAND_LAYOUT_MEL) {
+			float melLow = 2595.0f*log10f(1.0f + lowFreq/700.0f);
+			float melHigh = 2595.0f*log10f(1.0f + maxFreq/700.0f);
+			edges[i] = 700.0f*(powf(10.0f, (melLow + (melHigh-melLow)*per)/2595.0f) - 1.0f);
+		} else if(layout == BAND_LAYOUT_THIRD_OCTAVE) {
+			edges[i] = maxFreq*powf(2.0f, -(float)(numBands-i)/3.0f);
+		} else {
+			edges[i] = lowFreq*powf(maxFreq/lowFreq, per);
+		}
+	}
+}
+
+//! Builds the sparse bin to band weight table
+void CBandMapper::build()
+{
+	if(layout != BAND_LAYOUT_CUSTOM) calcEdges();
+	int numBins = fftSize/2;
+	float binWidth = (float)sampFreq/(float)fftSize;
+
+	//each band covers a run of consecutive bins, at most two of them partial
+	delete[] weightStart;
+	delete[] bandBin;
+	delete[] weightValue;
+	int maxWeights = numBins + numBands*2 + 2;
+	weightStart = new int[numBands+1];
+	bandBin = new int[numBands];
+	weightValue = new float[maxWeights];
+
+	int count = 0;
+	for(int b=0; b<numBands; b++) {
+		weightStart[b] = count;
+		float lo = edges[b]/binWidth;
+		float hi = edges[b+1]/binWidth;
+		if(lo < 0) lo = 0;
+		if(hi > numBins-1) hi = numBins-1;
+		if(lo > hi) lo = hi;
+
+		if(hi - lo < 1.0f) {
+			//narrower than a bin, interpolate at the band center
+			float center = (lo + hi)/2.0f;
+			int k = (int)center;
+			float frac = center - k;
+			bandBin[b] = k;
+			weightValue[count++] = 1.0f - frac;
+			if(frac > 0 && k+1 < numBins) weightValue[count++] = frac;
+		} else {
+			//average of the bins weighted by their overlap with the band (a bin only touching an edge keeps a zero weight)
+			float total = 0;
+			bandBin[b] = (int)(lo+0.5f);
+			for(int k=bandBin[b]; k<=(int)(hi+0.5f) && k<numBins; k++) {
+				float binLo = (k-0.5f > lo) ? k-0.5f : lo;
+				float binHi = (k+0.5f < hi) ? k+0.5f : hi;
+				float weight = (binHi > binLo) ? binHi - binLo : 0;
+				weightValue[count++] = weight;
+				total += weight;
+			}
+			for(int w=weightStart[b]; w<count; w++) weightValue[w] /= total;
+		}
+	}
+	weightStart[numBands] = count;
+	dirty = false;
+}
+
+//helper functions
+static void weightedSum(const float* specL, const float* specR, const float* weights, int count, float& sumL, float& sumR)
+{
+	//both channels share the weights, four bins per step
+	int i = 0;
+	sumL = 0;
+	sumR = 0;
+#if defined(BAND_SIMD_NEON)
+	float32x4_t accL = vdupq_n_f32(0);
+	float32x4_t accR = vdupq_n_f32(0);
+	for(; i+4<=count; i+=4) {
+		float32x4_t weight = vld1q_f32(weights + i);
+		accL = vmlaq_f32(accL, vld1q_f32(specL + i), weight);
+		accR = vmlaq_f32(accR, vld1q_f32(specR + i), weight);
+	}
+	float32x2_t pairL = vadd_f32(vget_low_f32(accL), vget_high_f32(accL));
+	float32x2_t pairR = vadd_f32(vget_low_f32(accR), vget_high_f32(accR));
+	sumL = vget_lane_f32(pairL, 0) + vget_lane_f32(pairL, 1);
+	sumR = vget_lane_f32(pairR, 0) + vget_lane_f32(pairR, 1);
+#elif defined(BAND_SIMD_SSE2)
+	__m128 accL = _mm_setzero_ps();
+	__m128 accR = _mm_setzero_ps();
+	for(; i+4<=count; i+=4) {
+		__m128 weight = _mm_loadu_ps(weights + i);
+		accL = _mm_add_ps(accL, _mm_mul_ps(_mm_loadu_ps(specL + i), weight));
+		accR = _mm_add_ps(accR, _mm_mul_ps(_mm_loadu_ps(specR + i), weight));
+	}
+	float laneL[4];
+	float laneR[4];
+	_mm_storeu_ps(laneL, accL);
+	_mm_storeu_ps(laneR, accR);
+	sumL = (laneL[0] + laneL[1]) + (laneL[2] + laneL[3]);
+	sumR = (laneR[0] + laneR[1]) + (laneR[2] + laneR[3]);
+#endif
+	for(; i<count; i++) {
+		sumL += specL[i]*weights[i];
+		sumR += specR[i]*weights[i];
+	}
+}
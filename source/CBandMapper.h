@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------------------
+// Title:	Band Mapper
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#ifndef BAND_MAPPER_H
+#define BAND_MAPPER_H
+
+#define BAND_LAYOUT_LINEAR 0
+#define BAND_LAYOUT_LOG 1
+#define BAND_LAYOUT_MEL 2
+#define BAND_LAYOUT_THIRD_OCTAVE 3
+#define BAND_LAYOUT_CUSTOM 4
+
+#define BAND_MAX_BANDS 256
+#define BAND_DEFAULT_MIN_FREQUENCY 40.0f
+
+
+//! Class that maps linear spectrum bins onto a set of frequency bands
+class CBandMapper
+{
+public:
+	//! Main constructor
+	CBandMapper();
+
+	//! Destructor
+	~CBandMapper();
+
+	//! Sets the band layout (custom layouts take numBands+1 ascending edge frequencies in Hz, others fall back to log)
+	void setLayout(int layout, int numBands, const float* edges = 0);
+
+	//! Sets the lowest edge frequency used by generated layouts
+	void setMinFrequency(float minFreq);
+
+	//! Sets the spectrum to map from (bins in the full fft and the sampling frequency)
+	void setSpectrum(int fftSize, unsigned int sampFreq);
+
+	//! Gets the number of bands
+	int getNumBands() const;
+
+	//! Gets the band edge frequency in Hz (0 to numBands)
+	float getBandEdge(int index) const;
+
+	//! Maps the spectrum bins to bands (weighted average of the bins in each band)
+	void map(const float* spec, float* bands);
+
+	//! Maps a pair of spectrums to bands in the same pass
+	void mapStereo(const float* specL, const float* specR, float* bandsL, float* bandsR);
+
+private:
+	int layout;
+	int numBands;
+	float minFreq;
+	int fftSize;
+	unsigned int sampFreq;
+	float edges[BAND_MAX_BANDS+1];
+	bool dirty;
+
+	int* weightStart;
+	int* bandBin;           //first bin of each band (its weights cover consecutive bins)
+	float* weightValue;
+
+	//! Calculates the band edges for generated layouts
+	void calcEdges();
+
+	//! Builds the sparse bin to band weight table
+	void build();
+};
+
+#endif
@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------------------
+// Title:	Beat Tracker
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#include "CBeatTracker.h"
+#include <math.h>
+
+#define BEAT_THRESHOLD 1.5f
+#define BEAT_THRESHOLD_MIN 0.01f
+#define BEAT_FLUX_MEMORY 2.0f
+#define BEAT_TEMPO_MEMORY 8.0f
+#define BEAT_REFRACTORY (BEAT_TICK_RATE/10)
+#define BEAT_PHASE_CORRECTION 0.2f
+#define BEAT_BPM_SMOOTH 0.1f
+
+//! Main constructor
+CBeatTracker::CBeatTracker() :
+	primed(false), tickTime(0), tickFlux(0), fluxMean(0), fluxVar(0), refractory(0), historyHead(0), 
+	onset(false), beat(false), phase(0), bpm(BEAT_DEFAULT_BPM)
+{
+	bandMapper.setLayout(BAND_LAYOUT_LOG, BEAT_NUM_BANDS);
+	for(int i=0; i<BEAT_NUM_BANDS; i++) bandEnergy[i] = 0;
+	for(int i=0; i<=BEAT_MAX_LAG; i++) {
+		onsetHistory[i] = 0;
+		acf[i] = 0;
+		
+		//log-normal tempo prior (one octave wide) to favor the default tempo over its multiples
+		float octaves = 0;
+		if(i > 0) octaves = log2f(((float)(BEAT_TICK_RATE*60)/(float)i)/(float)BEAT_DEFAULT_BPM);
+		tempoWeight[i] = expf(-0.5f*octaves*octaves);
+	}
+}
+
+//! Sets the spectrum to analyze (bins in the full fft and the sampling frequency)
+void CBeatTracker::setSpectrum(int fftSize, unsigned int sampFreq)
+{
+	bandMapper.setSpectrum(fftSize, sampFreq);
+}
+
+//! Advances the beat phase without a new spectrum frame
+void CBeatTracker::advance(double elapsedTime)
+{
+	onset = false;
+	beat = false;
+	if(elapsedTime > 1.0) elapsedTime = 1.0;
+	
+	phase += elapsedTime*bpm/60.0f;
+	if(phase >= 1.0f) {
+		phase -= (int)phase;
+		beat = true;
+	}
+}
+
+//! Analyzes a new spectrum frame for onsets without advancing the beat phase (given time since the previous frame)
+void CBeatTracker::analyze(const float* specL, const float* specR, double frameTime)
+{
+	if(frameTime > 1.0) frameTime = 1.0;
+	
+	//spectral flux (rectified rise in log band energy)
+	float flux = 0;
+	bandMapper.mapStereo(specL, specR, bandsL, bandsR);
+	for(int b=0; b<BEAT_NUM_BANDS; b++) {
+		float energy = logf(1.0f + bandsL[b] + bandsR[b]);
+		if(primed && energy > bandEnergy[b]) flux += energy - bandEnergy[b];
+		bandEnergy[b] = energy;
+	}
+	primed = true;
+	
+	//resample the flux onto fixed ticks so the envelope doesn't depend on frame rate
+	tickFlux += flux/BEAT_NUM_BANDS;
+	tickTime += frameTime;
+	while(tickTime >= 1.0/BEAT_TICK_RATE) {
+		tickTime -= 1.0/BEAT_TICK_RATE;
+		tick(tickFlux);
+		tickFlux = 0;
+	}
+}
+
+//! Gets if an onset was detected in the last frame
+bool CBeatTracker::getOnset() const
+{
+	return onset;
+}
+
+//! Gets if a beat occurred in the last frame
+bool CBeatTracker::getBeat() const
+{
+	return beat;
+}
+
+//! Gets the phase within the current beat (0.0 on the beat to 1.0)
+float CBeatTracker::getBeatPhase() const
+{
+	return phase;
+}
+
+//! Gets the estimated tempo in beats per minute
+float CBeatTracker::getBpm() const
+{
+	return bpm;
+}
+
+//! Processes one tick of the onset envelope
+void CBeatTracker::tick(float flux)
+{
+	//adaptive threshold from the running mean and variance of the flux
+	const float alpha = 1.0f/(BEAT_TICK_RATE*BEAT_FLUX_MEMORY);
+	float dev = flux - fluxMean;
+	bool detected = (refractory <= 0 && dev > BEAT_THRESHOLD*sqrtf(fluxVar) + BEAT_THRESHOLD_MIN);
+	fluxMean += alpha*dev;
+	fluxVar = (1.0f-alpha)*(fluxVar + alpha*dev*dev);
+	if(refractory > 0) refractory--;
+	
+	//pull the beat phase towards onsets that land near a predicted beat
+	if(detected) {
+		onset = true;
+		refractory = BEAT_REFRACTORY;
+		float err = (phase < 0.5f) ? phase : phase-1.0f;
+		if(fabsf(err) < 0.25f) phase -= err*BEAT_PHASE_CORRECTION;
+		if(phase < 0) phase += 1.0f;
+	}
+	
+	//running autocorrelation of the onset envelope over the tempo lags
+	const float decay = 1.0f - 1.0f/(BEAT_TICK_RATE*BEAT_TEMPO_MEMORY);
+	float env = (dev > 0) ? dev : 0;
+	historyHead = (historyHead+1)%(BEAT_MAX_LAG+1);
+	onsetHistory[historyHead] = env;
+	int best = 0;
+	float bestVal = 0;
+	for(int lag=BEAT_MIN_LAG; lag<=BEAT_MAX_LAG; lag++) {
+		acf[lag] = acf[lag]*decay + env*onsetHistory[(historyHead - lag + (BEAT_MAX_LAG+1))%(BEAT_MAX_LAG+1)];
+		if(acf[lag]*tempoWeight[lag] > bestVal) {
+			bestVal = acf[lag]*tempoWeight[lag];
+			best = lag;
+		}
+	}
+	
+	//refine the peak lag and ease the tempo towards it
+	if(best > 0) {
+		float lag = best;
+		if(best > BEAT_MIN_LAG && best < BEAT_MAX_LAG) {
+			float a = acf[best-1]*tempoWeight[best-1];
+			float c = acf[best+1]*tempoWeight[best+1];
+			float denom = a - 2.0f*bestVal + c;
+			if(denom < 0) lag += 0.5f*(a - c)/denom;
+		}
+		bpm += ((float)(BEAT_TICK_RATE*60)/lag - bpm)*BEAT_BPM_SMOOTH;
+	}
+}
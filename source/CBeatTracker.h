@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------------------
+// Title:	Beat Tracker
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#ifndef BEAT_TRACKER_H
+#define BEAT_TRACKER_H
+
+#include "CBandMapper.h"
+
+#define BEAT_NUM_BANDS 24
+#define BEAT_TICK_RATE 50
+#define BEAT_MIN_BPM 60
+#define BEAT_MAX_BPM 180
+#define BEAT_DEFAULT_BPM 120
+#define BEAT_MIN_LAG ((BEAT_TICK_RATE*60)/BEAT_MAX_BPM)
+#define BEAT_MAX_LAG ((BEAT_TICK_RATE*60)/BEAT_MIN_BPM)
+
+
+//! Class that detects onsets (spectral flux) and tracks tempo and beat phase
+class CBeatTracker
+{
+public:
+	//! Main constructor
+	CBeatTracker();
+
+	//! Sets the spectrum to analyze (bins in the full fft and the sampling frequency)
+	void setSpectrum(int fftSize, unsigned int sampFreq);
+
+	//! Advances the beat phase without a new spectrum frame
+	void advance(double elapsedTime);
+
+	//! Analyzes a new spectrum frame for onsets without advancing the beat phase (given time since the previous frame)
+	void analyze(const float* specL, const float* specR, double frameTime);
+
+	//! Gets if an onset was detected in the last frame
+	bool getOnset() const;
+
+	//! Gets if a beat occurred in the last frame
+	bool getBeat() const;
+
+	//! Gets the phase within the current beat (0.0 on the beat to 1.0)
+	float getBeatPhase() const;
+
+	//! Gets the estimated tempo in beats per minute
+	float getBpm() const;
+
+private:
+	CBandMapper bandMapper;
+	float bandEnergy[BEAT_NUM_BANDS];
+	float bandsL[BEAT_NUM_BANDS];
+	float bandsR[BEAT_NUM_BANDS];
+	bool primed;
+
+	double tickTime;
+	float tickFlux;
+	float fluxMean;
+	float fluxVar;
+	int refractory;
+
+	float onsetHistory[BEAT_MAX_LAG+1];
+	int historyHead;
+	float acf[BEAT_MAX_LAG+1];
+	float tempoWeight[BEAT_MAX_LAG+1];
+
+	bool onset;
+	bool beat;
+	float phase;
+	float bpm;
+
+	//! Processes one tick of the onset envelope
+	void tick(float flux);
+};
+
+#endif
@@ -0,0 +1,167 @@
+//-----------------------------------------------------------------------------------------
+// Title:	Constant Q Transform
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#include "CConstantQ.h"
+#include <math.h>
+
+static const double PI = 3.141592653589793238460;
+
+//! Main constructor
+CConstantQ::CConstantQ() :
+	fftSize(2), sampFreq(2), dirty(true), kernelStart(0), kernelBin(0), kernelRe(0), kernelIm(0)
+{
+}
+
+//! Destructor
+CConstantQ::~CConstantQ()
+{
+	delete[] kernelStart;
+	delete[] kernelBin;
+	delete[] kernelRe;
+	delete[] kernelIm;
+}
+
+//! Sets the spectrum to analyze (bins in the full fft and the sampling frequency)
+void CConstantQ::setSpectrum(int fftSize, unsigned int sampFreq)
+{
+	if(fftSize == this->fftSize && sampFreq == this->sampFreq) return;
+	this->fftSize = fftSize;
+	this->sampFreq = sampFreq;
+	dirty = true;
+}
+
+//! Gets the center frequency of a bin in Hz (bin 0 is C3)
+float CConstantQ::getFrequency(int bin) const
+{
+	return CQ_MIN_FREQUENCY*powf(2.0f, (float)bin/(float)CQ_BINS_PER_OCTAVE);
+}
+
+//! Transforms a hann windowed complex spectrum (fftSize/2 bins) into bin magnitudes
+void CConstantQ::transform(const float* re, const float* im, float* cq)
+{
+	if(dirty) build();
+	for(int k=0; k<CQ_NUM_BINS; k++) {
+		float sumRe = 0;
+		float sumIm = 0;
+		for(int w=kernelStart[k]; w<kernelStart[k+1]; w++) {
+			int b = kernelBin[w];
+			sumRe += re[b]*kernelRe[w] - im[b]*kernelIm[w];
+			sumIm += re[b]*kernelIm[w] + im[b]*kernelRe[w];
+		}
+		cq[k] = sqrtf(sumRe*sumRe + sumIm*sumIm);
+	}
+}
+
+//! Folds bin magnitudes into the 12 pitch classes (0 = C)
+void CConstantQ::fold(const float* cq, float* chroma)
+{
+	for(int i=0; i<CQ_BINS_PER_OCTAVE; i++) chroma[i] = 0;
+	for(int k=0; k<CQ_NUM_BINS; k++) chroma[k%CQ_BINS_PER_OCTAVE] += cq[k];
+}
+
+//! Builds the sparse spectral kernels
+void CConstantQ::build()
+{
+	int numBins = fftSize/2;
+	double q = 1.0/(pow(2.0, 1.0/CQ_BINS_PER_OCTAVE) - 1.0);
+	double* cosTable = new double[fftSize];
+	double* sinTable = new double[fftSize];
+	double* timeRe = new double[fftSize];
+	double* timeIm = new double[fftSize];
+	float* specRe = new float[CQ_NUM_BINS*numBins];
+	float* specIm = new float[CQ_NUM_BINS*numBins];
+	for(int n=0; n<fftSize; n++) {
+		cosTable[n] = cos(2*PI*n/fftSize);
+		sinTable[n] = sin(2*PI*n/fftSize);
+	}
+
+	int count = 0;
+	for(int k=0; k<CQ_NUM_BINS; k++) {
+		float* kRe = specRe + k*numBins;
+		float* kIm = specIm + k*numBins;
+		for(int j=0; j<numBins; j++) {
+			kRe[j] = 0;
+			kIm[j] = 0;
+		}
+		double freq = getFrequency(k);
+		if(freq >= sampFreq/2.0) continue;
+
+		//hann windowed exponential of Q periods, centered and clamped to the frame (low bins lose some resolution)
+		int length = (int)ceil(q*sampFreq/freq);
+		if(length > fftSize) length = fftSize;
+		int start = (fftSize-length)/2;
+		for(int n=0; n<fftSize; n++) {
+			timeRe[n] = 0;
+			timeIm[n] = 0;
+		}
+		for(int n=start; n<start+length; n++) {
+
+			//divide out the frame's own hann window so the kernel window is the only one applied
+			double window = 0.5*(1 - cos(2*PI*(n-start)/(length-1)));
+			double frameWindow = 0.5*(1 - cos(2*PI*n/(fftSize-1)));
+			double ratio = (frameWindow > 1e-9) ? window/frameWindow : 0;
+
+			//scaled so a sine reads the same as its peak in the linear spectrum
+			double scale = ratio*(fftSize/20.0)/length;
+			timeRe[n] = scale*cos(2*PI*freq*n/sampFreq);
+			timeIm[n] = scale*sin(2*PI*freq*n/sampFreq);
+		}
+
+		//conjugate of the kernel spectrum over the positive bins (the negative side is negligible)
+		float peak = 0;
+		for(int j=0; j<numBins; j++) {
+			double sumRe = 0;
+			double sumIm = 0;
+			for(int n=start; n<start+length; n++) {
+				int t = (j*n)%fftSize;
+				sumRe += timeRe[n]*cosTable[t] + timeIm[n]*sinTable[t];
+				sumIm += timeIm[n]*cosTable[t] - timeRe[n]*sinTable[t];
+			}
+			kRe[j] = sumRe/fftSize;
+			kIm[j] = -sumIm/fftSize;
+			float mag = sqrtf(kRe[j]*kRe[j] + kIm[j]*kIm[j]);
+			if(mag > peak) peak = mag;
+		}
+
+		//drop the near zero entries
+		for(int j=0; j<numBins; j++) {
+			if(sqrtf(kRe[j]*kRe[j] + kIm[j]*kIm[j]) < peak*CQ_KERNEL_THRESHOLD) {
+				kRe[j] = 0;
+				kIm[j] = 0;
+			} else {
+				count++;
+			}
+		}
+	}
+
+	//pack the kept entries
+	delete[] kernelStart;
+	delete[] kernelBin;
+	delete[] kernelRe;
+	delete[] kernelIm;
+	kernelStart = new int[CQ_NUM_BINS+1];
+	kernelBin = new unsigned short[count];
+	kernelRe = new float[count];
+	kernelIm = new float[count];
+	count = 0;
+	for(int k=0; k<CQ_NUM_BINS; k++) {
+		kernelStart[k] = count;
+		for(int j=0; j<numBins; j++) {
+			if(specRe[k*numBins + j] == 0 && specIm[k*numBins + j] == 0) continue;
+			kernelBin[count] = j;
+			kernelRe[count] = specRe[k*numBins + j];
+			kernelIm[count++] = specIm[k*numBins + j];
+		}
+	}
+	kernelStart[CQ_NUM_BINS] = count;
+
+	delete[] cosTable;
+	delete[] sinTable;
+	delete[] timeRe;
+	delete[] timeIm;
+	delete[] specRe;
+	delete[] specIm;
+	dirty = false;
+}
@@ -0,0 +1,52 @@
+//-----------------------------------------------------------------------------------------
+// Title:	Constant Q Transform
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#ifndef CONSTANT_Q_H
+#define CONSTANT_Q_H
+
+#define CQ_BINS_PER_OCTAVE 12
+#define CQ_NUM_OCTAVES 4
+#define CQ_NUM_BINS (CQ_BINS_PER_OCTAVE*CQ_NUM_OCTAVES)
+#define CQ_MIN_FREQUENCY 130.8128f
+#define CQ_KERNEL_THRESHOLD 0.0054f
+
+
+//! Class that maps a complex fft spectrum onto semitone spaced constant q bins (sparse spectral kernels)
+class CConstantQ
+{
+public:
+	//! Main constructor
+	CConstantQ();
+
+	//! Destructor
+	~CConstantQ();
+
+	//! Sets the spectrum to analyze (bins in the full fft and the sampling frequency)
+	void setSpectrum(int fftSize, unsigned int sampFreq);
+
+	//! Gets the center frequency of a bin in Hz (bin 0 is C3)
+	float getFrequency(int bin) const;
+
+	//! Transforms a hann windowed complex spectrum (fftSize/2 bins) into bin magnitudes
+	void transform(const float* re, const float* im, float* cq);
+
+	//! Folds bin magnitudes into the 12 pitch classes (0 = C)
+	static void fold(const float* cq, float* chroma);
+
+private:
+	int fftSize;
+	unsigned int sampFreq;
+	bool dirty;
+
+	int* kernelStart;
+	unsigned short* kernelBin;
+	float* kernelRe;
+	float* kernelIm;
+
+	//! Builds the sparse spectral kernels
+	void build();
+};
+
+#endif
@@ -5,66 +5,268 @@
 //-----------------------------------------------------------------------------------------
 #include "CSoundAnalyzer.h"
 #include "snd.h"
+#include "mtr.h"
 #include <complex>
 #include <iostream>
 #include <valarray>
+#include <math.h>
+#include <string.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SND_SIMD_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SND_SIMD_SSE2
+#endif
  
 typedef std::complex<double> Complex;
 typedef std::valarray<Complex> CArray;
 
+#define FIXED_MAG_ALPHA 31470   //0.96043 in q15
+#define FIXED_MAG_BETA 13036    //0.39782 in q15
+#define FIXED_DIV_20 3277       //1/20 in q16
+
+#define RESAMPLE_SOURCE_WAVE 0
+#define RESAMPLE_SOURCE_SPEC 1
+#define RESAMPLE_SOURCE_BANDS 2
+#define RESAMPLE_SOURCE_SPEC_DB 3
+
+#define DB_PER_OCTAVE 6.0206f   //20*log10(2)
+
 static const double PI = 3.141592653589793238460;
 static void fft(CArray& x);
 
+static short fixedHann[SND_BUFFER_SAMPLE_SIZE];
+static short fixedHannShort[SND_MULTIRES_SHORT_SIZE];
+static short fixedCos[SND_BUFFER_SAMPLE_SIZE/2];
+static short fixedSin[SND_BUFFER_SAMPLE_SIZE/2];
+static unsigned short fixedBitReverse[SND_BUFFER_SAMPLE_SIZE];
+static void fftFixedInit();
+static int fftFixed(int* re, int* im, int n);
+static int fixedMagnitude(int re, int im, int exponent);
+static int toQ15(float value);
+static float timeCoefficient(float timeConstant, double elapsedTime);
+static float normalize(float value, float scale, float min);
+static float normalizeLevel(float value, float scale);
+static void fastLog2Map(const float* in, float* out, int n, float scale, float offset);
+
 //! Main constructor
 CSoundAnalyzer::CSoundAnalyzer() :
-	sampFreq(SND_DEFAULT_SAMPLE_FREQUENCY), waveLPF(SND_DEFAULT_WAVE_LP_FILTER), waveTimeSmooth(SND_DEFAULT_WAVE_TIME_SMOOTH), 
-	specSmoothPass(SND_DEFAULT_SPEC_SMOOTH_PASS), specTimeSmooth(SND_DEFAULT_SPEC_TIME_SMOOTH)
+	sampFreq(SND_DEFAULT_SAMPLE_FREQUENCY), waveLPF(SND_DEFAULT_WAVE_LP_FILTER), specSmoothPass(SND_DEFAULT_SPEC_SMOOTH_PASS), fixedPoint(SND_DEFAULT_FIXED_POINT),
+	features(SND_FEATURE_ALL), skippedStages(0), redundantRefreshes(0),
+	waveAttack(SND_DEFAULT_WAVE_ATTACK), waveRelease(SND_DEFAULT_WAVE_RELEASE), specAttack(SND_DEFAULT_SPEC_ATTACK), specRelease(SND_DEFAULT_SPEC_RELEASE),
+	bandAttack(SND_DEFAULT_BAND_ATTACK), bandRelease(SND_DEFAULT_BAND_RELEASE), vuAttack(SND_DEFAULT_VU_ATTACK), vuRelease(SND_DEFAULT_VU_RELEASE),
+	agc(SND_DEFAULT_AGC), agcTarget(SND_DEFAULT_AGC_TARGET), agcAttack(SND_DEFAULT_AGC_ATTACK), agcRelease(SND_DEFAULT_AGC_RELEASE), agcGain(1.0f),
+	dbFloor(SND_DEFAULT_DB_FLOOR), dbCeiling(SND_DEFAULT_DB_CEILING)
 {
+	fftFixedInit();
+	waveLPFQ15 = toQ15(waveLPF);
+	setSpecSmoothPass(specSmoothPass);
+	calcTimeCoefficients(0);
+
 	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) {
 		waveLeft[i] = 0;
 		waveRight[i] = 0;
+		frameWaveLeft[i] = 0;
+		frameWaveRight[i] = 0;
+	}
+	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/2; i++) {
 		specLeft[i] = 0;
 		specRight[i] = 0;
+		frameSpecLeft[i] = 0;
+		frameSpecRight[i] = 0;
+		specDBLeft[i] = 0;
+		specDBRight[i] = 0;
+	}
+	for(int i=0; i<BAND_MAX_BANDS; i++) {
+		bandLeft[i] = 0;
+		bandRight[i] = 0;
+		frameBandLeft[i] = 0;
+		frameBandRight[i] = 0;
+	}
+	bandMapper.setLayout(SND_DEFAULT_BAND_LAYOUT, SND_DEFAULT_NUM_BANDS);
+	for(int i=0; i<CQ_NUM_BINS; i++) {
+		cqBins[i] = 0;
+		frameCQ[i] = 0;
 	}
+	for(int i=0; i<CQ_BINS_PER_OCTAVE; i++) chroma[i] = 0;
+	chromaPeak = 0;
+	multiResolution = SND_DEFAULT_MULTI_RESOLUTION;
+	multiResDirty = true;
+	multiResLowBands = 0;
+	longSkips = 0;
+	longFrameTime = 0;
+	history = 0;
+	for(int e=0; e<SND_RESAMPLE_CACHE_ENTRIES; e++) resampleCache[e].sequence = 0;
+	resampleNext = 0;
+	outputSequence = 1;
+	historyMapper.setLayout(SND_DEFAULT_HISTORY_LAYOUT, SND_DEFAULT_HISTORY_BANDS);
+	setHistoryBudget(SND_DEFAULT_HISTORY_BUDGET);
+	frameSequence = 0;
+	frameFeatures = 0;
+	frameTime = 0;
 	
-	bassLeft = 0;
-	midLeft = 0;
-	trebLeft = 0;
-	vuLeft = 0;
-	bassRight = 0;
-	midRight = 0;
-	trebRight = 0;
-	vuRight = 0;
+	bassLeft = frameBassLeft = 0;
+	midLeft = frameMidLeft = 0;
+	trebLeft = frameTrebLeft = 0;
+	vuLeft = frameVULeft = 0;
+	bassRight = frameBassRight = 0;
+	midRight = frameMidRight = 0;
+	trebRight = frameTrebRight = 0;
+	vuRight = frameVURight = 0;
+}
+
+//! Destructor
+CSoundAnalyzer::~CSoundAnalyzer()
+{
+	delete[] history;
 }
 	
 //! Sets the sampling frequency
 void CSoundAnalyzer::setSamplingFrequency(unsigned int sampFreq)
 {
 	this->sampFreq = sampFreq;
+	multiResDirty = true;
+	frameFeatures = 0;
 }
 
 //! Sets the low pass filter value on wave data (1.0 = off)
 void CSoundAnalyzer::setWaveLPF(float waveLPF)
 {
 	this->waveLPF = waveLPF;
-}
-
-//! Sets the time smooth value for wave data (1.0 = off)
-void CSoundAnalyzer::setWaveTimeSmooth(float waveTimeSmooth)
-{
-	this->waveTimeSmooth = waveTimeSmooth;
+	waveLPFQ15 = toQ15(waveLPF);
+	frameFeatures = 0;
 }
 
 //! Sets the smooth factor for spectrum data
 void CSoundAnalyzer::setSpecSmoothPass(unsigned char specSmoothPass)
 {
 	this->specSmoothPass = specSmoothPass;
+	frameFeatures = 0;
+	smoothKernelSize = smo_buildKernel(specSmoothPass, smoothKernel, smoothKernelQ15);
+}
+
+//! Sets the attack and release time constants for wave data in seconds (0 = off)
+void CSoundAnalyzer::setWaveTimeConstants(float attack, float release)
+{
+	waveAttack = attack;
+	waveRelease = release;
+	calcTimeCoefficients(coefElapsedTime);
+}
+
+//! Sets the attack and release time constants for spectrum data in seconds (0 = off)
+void CSoundAnalyzer::setSpecTimeConstants(float attack, float release)
+{
+	specAttack = attack;
+	specRelease = release;
+	calcTimeCoefficients(coefElapsedTime);
+}
+
+//! Sets the attack and release time constants for bands, bass, mid and treble in seconds (0 = off)
+void CSoundAnalyzer::setBandTimeConstants(float attack, float release)
+{
+	bandAttack = attack;
+	bandRelease = release;
+	calcTimeCoefficients(coefElapsedTime);
+}
+
+//! Sets the attack and release time constants for volume in seconds (0 = off)
+void CSoundAnalyzer::setVUTimeConstants(float attack, float release)
+{
+	vuAttack = attack;
+	vuRelease = release;
+	calcTimeCoefficients(coefElapsedTime);
+}
+
+//! Sets the fixed point (q15) analysis path on or off
+void CSoundAnalyzer::setFixedPoint(bool fixedPoint)
+{
+	this->fixedPoint = fixedPoint;
+	frameFeatures = 0;
+}
+
+//! Sets the multi-resolution bands on or off (bands above the crossover come from a short window at a higher rate)
+void CSoundAnalyzer::setMultiResolution(bool multiResolution)
+{
+	this->multiResolution = multiResolution;
+	multiResDirty = true;
+	frameFeatures = 0;
+}
+
+//! Sets the levels in dB (after gain, 0dB = full scale of the normalized spectrum) mapped to 0.0 and 1.0 by the dB spectrum
+void CSoundAnalyzer::setDBRange(float floor, float ceiling)
+{
+	if(ceiling <= floor) ceiling = floor + 1.0f;
+	dbFloor = floor;
+	dbCeiling = ceiling;
+	calcSpectrumDB();
+	outputSequence++;
+}
+
+//! Sets the automatic gain control on or off (scales the normalized outputs)
+void CSoundAnalyzer::setAGC(bool agc)
+{
+	this->agc = agc;
+	if(!agc) {
+		agcGain = 1.0f;
+		calcSpectrumDB();
+		outputSequence++;
+	}
+}
+
+//! Sets the short-term loudness the automatic gain control aims for (LUFS)
+void CSoundAnalyzer::setAGCTarget(float loudness)
+{
+	agcTarget = loudness;
+}
+
+//! Sets the attack (gain falling) and release (gain rising) time constants for the automatic gain in seconds
+void CSoundAnalyzer::setAGCTimeConstants(float attack, float release)
+{
+	agcAttack = attack;
+	agcRelease = release;
+	calcTimeCoefficients(coefElapsedTime);
+}
+
+//! Sets the analysis features to run on refresh (SND_FEATURE_* flags, the rest hold their last values)
+void CSoundAnalyzer::setFeatures(int features)
+{
+	this->features = features;
+}
+
+//! Gets the analysis features run on refresh
+int CSoundAnalyzer::getFeatures()
+{
+	return features;
 }
 
-//! Sets the time smooth value for spectrum data (1.0 = off)
-void CSoundAnalyzer::setSpecTimeSmooth(float specTimeSmooth)
+//! Gets the number of analysis stages skipped so far because no feature needed them
+unsigned int CSoundAnalyzer::getSkippedStages()
 {
-	this->specTimeSmooth = specTimeSmooth;
+	return skippedStages;
+}
+
+//! Gets the number of refreshes so far that reused the last analysis because no new audio had arrived
+unsigned int CSoundAnalyzer::getRedundantRefreshes()
+{
+	return redundantRefreshes;
+}
+
+//! Sets the band layout and number of bands (custom layouts take numBands+1 ascending edges in Hz up to the nyquist, others fall back to log)
+void CSoundAnalyzer::setBandLayout(int layout, int numBands, const float* edges)
+{
+	//custom edges past the nyquist of the analyzed spectrum would only repeat the top bin (falls back to log like unordered edges)
+	unsigned int maxFreq = multiResolution ? sampFreq*SND_MULTIRES_RATE_FACTOR : sampFreq;
+	if(maxFreq > snd_getBufferRate()) maxFreq = snd_getBufferRate();
+	if(layout == BAND_LAYOUT_CUSTOM && edges && numBands > 0 && edges[(numBands < BAND_MAX_BANDS) ? numBands : BAND_MAX_BANDS] > maxFreq/2.0f) layout = BAND_LAYOUT_LOG;
+	bandMapper.setLayout(layout, numBands, edges);
+	for(int i=0; i<BAND_MAX_BANDS; i++) {
+		bandLeft[i] = 0;
+		bandRight[i] = 0;
+	}
+	multiResDirty = true;
+	frameFeatures = 0;
+	outputSequence++;
 }
 
 //! Gets the left waveform samples
@@ -86,18 +288,44 @@ short CSoundAnalyzer::getWaveRight(int index)
 //! Gets the left spectrum samples
 short CSoundAnalyzer::getSpecLeft(int index)
 {
-	if(index < 0) return specLeft[0];
-	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) return specLeft[SND_BUFFER_SAMPLE_SIZE-1];
+	if(index < 0) index = 0;
+	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) index = SND_BUFFER_SAMPLE_SIZE-1;
+	if(index >= SND_BUFFER_SAMPLE_SIZE/2) index = (SND_BUFFER_SAMPLE_SIZE-1)-index; //data mirrors at the middle after fft
 	return specLeft[index];
 }
 
 //! Gets the right spectrum samples
 short CSoundAnalyzer::getSpecRight(int index)
 {
-	if(index < 0) return specRight[0];
-	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) return specRight[SND_BUFFER_SAMPLE_SIZE-1];
+	if(index < 0) index = 0;
+	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) index = SND_BUFFER_SAMPLE_SIZE-1;
+	if(index >= SND_BUFFER_SAMPLE_SIZE/2) index = (SND_BUFFER_SAMPLE_SIZE-1)-index; //data mirrors at the middle after fft
 	return specRight[index];
 }
+
+//! Gets the number of bands in the band layout
+int CSoundAnalyzer::getNumBands()
+{
+	return bandMapper.getNumBands();
+}
+
+//! Gets the left band values
+short CSoundAnalyzer::getBandLeft(int band)
+{
+	int numBands = bandMapper.getNumBands();
+	if(band < 0) return bandLeft[0];
+	if(band > (numBands-1)) return bandLeft[numBands-1];
+	return bandLeft[band];
+}
+
+//! Gets the right band values
+short CSoundAnalyzer::getBandRight(int band)
+{
+	int numBands = bandMapper.getNumBands();
+	if(band < 0) return bandRight[0];
+	if(band > (numBands-1)) return bandRight[numBands-1];
+	return bandRight[band];
+}
 	
 //! Gets the left bass value
 int CSoundAnalyzer::getBassLeft()
@@ -147,21 +375,561 @@ int CSoundAnalyzer::getVURight()
 	return vuRight;
 }
 
-//! Clears the video buffer to the specified color
-void CSoundAnalyzer::refresh()
+//! Gets if an onset was detected in the last refresh
+bool CSoundAnalyzer::getOnset()
 {
-	snd_collectSamples(waveRaw, sampFreq, SND_BUFFER_SAMPLE_SIZE*2);
+	return beatTracker.getOnset();
+}
 
-	//wave processing
-	short wL = 0;
-	short wR = 0;
-	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) {
-		wL = wL*(1.0-waveLPF) + waveRaw[i*2 +0]*waveLPF;
-		waveLeft[i] = waveLeft[i]*(1.0-waveTimeSmooth) + wL*waveTimeSmooth;
-		wR = wR*(1.0-waveLPF) + waveRaw[i*2 +1]*waveLPF;
-		waveRight[i] = waveRight[i]*(1.0-waveTimeSmooth) + wR*waveTimeSmooth;
+//! Gets if a beat occurred in the last refresh
+bool CSoundAnalyzer::getBeat()
+{
+	return beatTracker.getBeat();
+}
+
+//! Gets the phase within the current beat (0.0 on the beat to 1.0)
+float CSoundAnalyzer::getBeatPhase()
+{
+	return beatTracker.getBeatPhase();
+}
+
+//! Gets the estimated tempo in beats per minute
+float CSoundAnalyzer::getBpm()
+{
+	return beatTracker.getBpm();
+}
+
+//! Gets the left channel time domain rms level (0.0 to 1.0 of full scale)
+float CSoundAnalyzer::getRMSLeft()
+{
+	return mtr_getRMSLeft();
+}
+
+//! Gets the right channel time domain rms level (0.0 to 1.0 of full scale)
+float CSoundAnalyzer::getRMSRight()
+{
+	return mtr_getRMSRight();
+}
+
+//! Gets the K-weighted short-term loudness (LUFS)
+float CSoundAnalyzer::getLoudness()
+{
+	return mtr_getLoudness();
+}
+
+//! Gets the current automatic gain
+float CSoundAnalyzer::getAGCGain()
+{
+	return agcGain;
+}
+
+//! Gets a filterbank envelope (FBK_BAND_*) straight from the sound thread, a few ms old (0.0 to 1.0 of full scale)
+float CSoundAnalyzer::getEnvelope(int band)
+{
+	return fbk_getEnvelope(band);
+}
+
+//! Gets the left waveform samples after gain (-1.0 to 1.0)
+float CSoundAnalyzer::getWaveLeftNorm(int index)
+{
+	if(index < 0) index = 0;
+	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) index = SND_BUFFER_SAMPLE_SIZE-1;
+	return normalize(waveLeft[index], agcGain/SND_NORM_WAVE, -1.0f);
+}
+
+//! Gets the right waveform samples after gain (-1.0 to 1.0)
+float CSoundAnalyzer::getWaveRightNorm(int index)
+{
+	if(index < 0) index = 0;
+	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) index = SND_BUFFER_SAMPLE_SIZE-1;
+	return normalize(waveRight[index], agcGain/SND_NORM_WAVE, -1.0f);
+}
+
+//! Gets the left spectrum samples after gain (0.0 to 1.0)
+float CSoundAnalyzer::getSpecLeftNorm(int index)
+{
+	if(index < 0) index = 0;
+	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) index = SND_BUFFER_SAMPLE_SIZE-1;
+	if(index >= SND_BUFFER_SAMPLE_SIZE/2) index = (SND_BUFFER_SAMPLE_SIZE-1)-index; //data mirrors at the middle after fft
+	return normalize(specLeft[index], agcGain/SND_NORM_SPEC, 0.0f);
+}
+
+//! Gets the right spectrum samples after gain (0.0 to 1.0)
+float CSoundAnalyzer::getSpecRightNorm(int index)
+{
+	if(index < 0) index = 0;
+	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) index = SND_BUFFER_SAMPLE_SIZE-1;
+	if(index >= SND_BUFFER_SAMPLE_SIZE/2) index = (SND_BUFFER_SAMPLE_SIZE-1)-index; //data mirrors at the middle after fft
+	return normalize(specRight[index], agcGain/SND_NORM_SPEC, 0.0f);
+}
+
+//! Gets the left spectrum samples after gain in dB mapped from the dB range (0.0 to 1.0)
+float CSoundAnalyzer::getSpecLeftDB(int index)
+{
+	if(index < 0) index = 0;
+	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) index = SND_BUFFER_SAMPLE_SIZE-1;
+	if(index >= SND_BUFFER_SAMPLE_SIZE/2) index = (SND_BUFFER_SAMPLE_SIZE-1)-index; //data mirrors at the middle after fft
+	return specDBLeft[index];
+}
+
+//! Gets the right spectrum samples after gain in dB mapped from the dB range (0.0 to 1.0)
+float CSoundAnalyzer::getSpecRightDB(int index)
+{
+	if(index < 0) index = 0;
+	if(index > (SND_BUFFER_SAMPLE_SIZE-1)) index = SND_BUFFER_SAMPLE_SIZE-1;
+	if(index >= SND_BUFFER_SAMPLE_SIZE/2) index = (SND_BUFFER_SAMPLE_SIZE-1)-index; //data mirrors at the middle after fft
+	return specDBRight[index];
+}
+
+//! Gets the left band values after gain (0.0 to 1.0)
+float CSoundAnalyzer::getBandLeftNorm(int band)
+{
+	int numBands = bandMapper.getNumBands();
+	if(band < 0) band = 0;
+	if(band > (numBands-1)) band = numBands-1;
+	return normalize(bandLeft[band], agcGain/SND_NORM_BAND, 0.0f);
+}
+
+//! Gets the right band values after gain (0.0 to 1.0)
+float CSoundAnalyzer::getBandRightNorm(int band)
+{
+	int numBands = bandMapper.getNumBands();
+	if(band < 0) band = 0;
+	if(band > (numBands-1)) band = numBands-1;
+	return normalize(bandRight[band], agcGain/SND_NORM_BAND, 0.0f);
+}
+
+//! Gets the left bass value after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getBassLeftNorm()
+{
+	return normalizeLevel(bassLeft, agcGain/SND_NORM_BAND);
+}
+
+//! Gets the right bass value after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getBassRightNorm()
+{
+	return normalizeLevel(bassRight, agcGain/SND_NORM_BAND);
+}
+
+//! Gets the left mid value after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getMidLeftNorm()
+{
+	return normalizeLevel(midLeft, agcGain/SND_NORM_BAND);
+}
+
+//! Gets the right mid value after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getMidRightNorm()
+{
+	return normalizeLevel(midRight, agcGain/SND_NORM_BAND);
+}
+
+//! Gets the left treble value after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getTrebLeftNorm()
+{
+	return normalizeLevel(trebLeft, agcGain/SND_NORM_BAND);
+}
+
+//! Gets the right treble value after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getTrebRightNorm()
+{
+	return normalizeLevel(trebRight, agcGain/SND_NORM_BAND);
+}
+
+//! Gets the left channel volume after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getVULeftNorm()
+{
+	return normalizeLevel(vuLeft, agcGain/SND_NORM_VU);
+}
+
+//! Gets the right channel volume after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getVURightNorm()
+{
+	return normalizeLevel(vuRight, agcGain/SND_NORM_VU);
+}
+
+//! Gets a filterbank envelope (FBK_BAND_*) after gain (0.0 up, 1.0 at full level and above it when louder)
+float CSoundAnalyzer::getEnvelopeNorm(int band)
+{
+	return normalizeLevel(fbk_getEnvelope(band), agcGain/SND_NORM_ENVELOPE);
+}
+
+//! Gets the constant q (semitone) bin values (bin 0 is C3)
+short CSoundAnalyzer::getCQ(int bin)
+{
+	if(bin < 0) return cqBins[0];
+	if(bin > (CQ_NUM_BINS-1)) return cqBins[CQ_NUM_BINS-1];
+	return cqBins[bin];
+}
+
+//! Gets the center frequency of a constant q bin in Hz
+float CSoundAnalyzer::getCQFrequency(int bin)
+{
+	return constantQ.getFrequency(bin);
+}
+
+//! Gets the chroma value of a pitch class (0 = C, wraps around) relative to the strongest one (0.0 to 1.0)
+float CSoundAnalyzer::getChroma(int pitchClass)
+{
+	pitchClass %= CQ_BINS_PER_OCTAVE;
+	if(pitchClass < 0) pitchClass += CQ_BINS_PER_OCTAVE;
+	return chroma[pitchClass];
+}
+
+//! Gets the strongest pitch class (0 = C)
+int CSoundAnalyzer::getChromaPeak()
+{
+	return chromaPeak;
+}
+
+//! Sets the band layout and number of bands kept in the spectrum history (clears the history)
+void CSoundAnalyzer::setHistoryLayout(int layout, int numBands)
+{
+	historyMapper.setLayout(layout, numBands);
+	setHistoryBudget(historyBudget);
+}
+
+//! Sets the memory the spectrum history may use in bytes (sets the number of frames kept, clears the history)
+void CSoundAnalyzer::setHistoryBudget(unsigned int bytes)
+{
+	historyBudget = bytes;
+	historySize = bytes/(historyMapper.getNumBands()*2*sizeof(short));
+	historyLength = 0;
+	historyHead = 0;
+	delete[] history;
+	history = 0;
+	if(historySize > 0) history = new short[historySize*historyMapper.getNumBands()*2];
+}
+
+//! Gets the number of bands in each spectrum history frame
+int CSoundAnalyzer::getHistoryNumBands()
+{
+	return historyMapper.getNumBands();
+}
+
+//! Gets the number of frames the spectrum history can hold
+int CSoundAnalyzer::getHistorySize()
+{
+	return historySize;
+}
+
+//! Gets the number of frames currently in the spectrum history
+int CSoundAnalyzer::getHistoryLength()
+{
+	return historyLength;
+}
+
+//! Gets a left band value from the spectrum history (age 0 is the newest frame, 0 past the oldest)
+short CSoundAnalyzer::getHistoryLeft(int age, int band)
+{
+	int numBands = historyMapper.getNumBands();
+	if(age < 0 || age >= historyLength || band < 0 || band >= numBands) return 0;
+	int slot = historyHead - age;
+	if(slot < 0) slot += historySize;
+	return history[slot*numBands*2 + band];
+}
+
+//! Gets a right band value from the spectrum history (age 0 is the newest frame, 0 past the oldest)
+short CSoundAnalyzer::getHistoryRight(int age, int band)
+{
+	int numBands = historyMapper.getNumBands();
+	if(age < 0 || age >= historyLength || band < 0 || band >= numBands) return 0;
+	int slot = historyHead - age;
+	if(slot < 0) slot += historySize;
+	return history[slot*numBands*2 + numBands + band];
+}
+
+//! Gets a left band value from the spectrum history after gain (0.0 to 1.0)
+float CSoundAnalyzer::getHistoryLeftNorm(int age, int band)
+{
+	return normalize(getHistoryLeft(age, band), agcGain/SND_NORM_BAND, 0.0f);
+}
+
+//! Gets a right band value from the spectrum history after gain (0.0 to 1.0)
+float CSoundAnalyzer::getHistoryRightNorm(int age, int band)
+{
+	return normalize(getHistoryRight(age, band), agcGain/SND_NORM_BAND, 0.0f);
+}
+
+//! Fills out with count waveform points after gain (-1.0 to 1.0) taken at start + i*step samples
+void CSoundAnalyzer::getWave(int channel, int count, float* out, float start, float step, int interpolation)
+{
+	resample(RESAMPLE_SOURCE_WAVE, channel, count, out, start, step, false, interpolation);
+}
+
+//! Fills out with count spectrum points after gain (0.0 to 1.0) spread over the spectrum (log spacing starts at bin 1)
+void CSoundAnalyzer::getSpectrum(int channel, int count, float* out, int spacing, int interpolation)
+{
+	if(count <= 0) return;
+	int size = SND_BUFFER_SAMPLE_SIZE/2;
+	if(spacing == SND_SPACING_LOG) {
+		float ratio = (count > 1) ? powf((float)(size-1), 1.0f/(count-1)) : 1.0f;
+		resample(RESAMPLE_SOURCE_SPEC, channel, count, out, 1.0f, ratio, true, interpolation);
+	} else {
+		resample(RESAMPLE_SOURCE_SPEC, channel, count, out, 0.0f, (float)size/count, false, interpolation);
+	}
+}
+
+//! Fills out with count dB spectrum points (0.0 to 1.0) spread over the spectrum (log spacing starts at bin 1)
+void CSoundAnalyzer::getSpectrumDB(int channel, int count, float* out, int spacing, int interpolation)
+{
+	if(count <= 0) return;
+	int size = SND_BUFFER_SAMPLE_SIZE/2;
+	if(spacing == SND_SPACING_LOG) {
+		float ratio = (count > 1) ? powf((float)(size-1), 1.0f/(count-1)) : 1.0f;
+		resample(RESAMPLE_SOURCE_SPEC_DB, channel, count, out, 1.0f, ratio, true, interpolation);
+	} else {
+		resample(RESAMPLE_SOURCE_SPEC_DB, channel, count, out, 0.0f, (float)size/count, false, interpolation);
+	}
+}
+
+//! Fills out with count band values after gain (0.0 to 1.0) spread evenly over the band layout
+void CSoundAnalyzer::getBands(int channel, int count, float* out, int interpolation)
+{
+	if(count <= 0) return;
+	resample(RESAMPLE_SOURCE_BANDS, channel, count, out, 0.0f, (float)bandMapper.getNumBands()/count, false, interpolation);
+}
+
+//! Refreshes the sound data (given time since the last refresh in seconds)
+void CSoundAnalyzer::refresh(double elapsedTime)
+{
+	if(fabs(elapsedTime - coefElapsedTime) > coefElapsedTime*SND_COEF_TIME_TOLERANCE) calcTimeCoefficients(elapsedTime);
+	frameTime += elapsedTime;
+	beatTracker.advance(elapsedTime);
+	
+	//automatic gain from the short-term loudness of the stream (held while the input is gated as silence)
+	float loudness = mtr_getLoudness();
+	if(!agc) {
+		agcGain = 1.0f;
+	} else if(loudness > SND_AGC_GATE) {
+		float gain = powf(10.0f, (agcTarget - loudness)/20.0f);
+		if(gain < SND_AGC_MIN_GAIN) gain = SND_AGC_MIN_GAIN;
+		if(gain > SND_AGC_MAX_GAIN) gain = SND_AGC_MAX_GAIN;
+		agcGain += (gain - agcGain)*((gain < agcGain) ? agcAttackCoef : agcReleaseCoef);
+	}
+	
+	//only analyze when new audio arrived (or the last analysis is missing a feature), the envelopes run either way
+	unsigned int sequence = snd_getWriteSequence();
+	if(sequence != frameSequence || (features & ~frameFeatures)) {
+		snd_collectSamples(waveRaw, sampFreq, SND_BUFFER_SAMPLE_SIZE*2);
+		analyzeFrame(sequence != frameSequence);
+		frameSequence = sequence;
+		frameFeatures = features;
+		frameTime = 0;
+	} else {
+		redundantRefreshes++;
+	}
+	applyEnvelopes();
+	calcSpectrumDB();
+	outputSequence++;
+}
+
+//! Analyzes the collected samples into the frame values for the requested features (newAudio when not analyzed before)
+void CSoundAnalyzer::analyzeFrame(bool newAudio)
+{
+	//wave processing (each channel only when asked for)
+	for(int c=0; c<2; c++) {
+		float* wave = (c == 0) ? frameWaveLeft : frameWaveRight;
+		if(!(features & ((c == 0) ? SND_FEATURE_WAVE_LEFT : SND_FEATURE_WAVE_RIGHT))) {
+			skippedStages++;
+			continue;
+		}
+		if(fixedPoint) {
+			int w = 0;
+			for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) {
+				w += ((waveRaw[i*2 + c] - w)*waveLPFQ15) >> 15;
+				wave[i] = w;
+			}
+		} else {
+			short w = 0;
+			for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) {
+				w = w*(1.0-waveLPF) + waveRaw[i*2 + c]*waveLPF;
+				wave[i] = w;
+			}
+		}
+	}
+	
+	//everything past here works off the spectrum
+	if(!(features & (SND_FEATURE_SPEC | SND_FEATURE_BANDS | SND_FEATURE_LEVELS | SND_FEATURE_BEAT | SND_FEATURE_CHROMA | SND_FEATURE_HISTORY))) {
+		skippedStages += 7;
+		return;
+	}
+	
+	//multi-resolution bands take the short window every frame, the long window only runs every few frames (the rest hold)
+	longFrameTime += frameTime;
+	if(multiResolution && (features & SND_FEATURE_BANDS)) {
+		bool runLong = !newAudio || multiResDirty || ++longSkips >= SND_MULTIRES_LONG_INTERVAL;
+		analyzeShortBands();
+		if(!runLong) return;
+		longSkips = 0;
+	}
+	
+	//spectrum analysis
+	float reLeft[SND_BUFFER_SAMPLE_SIZE/2];
+	float imLeft[SND_BUFFER_SAMPLE_SIZE/2];
+	float reRight[SND_BUFFER_SAMPLE_SIZE/2];
+	float imRight[SND_BUFFER_SAMPLE_SIZE/2];
+	if(fixedPoint) {
+		analyzeSpectrumFixed(0, frameSpecLeft, reLeft, imLeft);
+		analyzeSpectrumFixed(1, frameSpecRight, reRight, imRight);
+	} else {
+		analyzeSpectrum(frameSpecLeft, frameSpecRight, reLeft, imLeft, reRight, imRight);
+	}
+	if(!(features & SND_FEATURE_SPEC)) skippedStages++;
+	
+	//spectrum analysis - bands (single pass over the precomputed bin weights)
+	if((features & SND_FEATURE_BANDS) && multiResolution) {
+		float lowLeft[BAND_MAX_BANDS];
+		float lowRight[BAND_MAX_BANDS];
+		multiResMapper.setSpectrum(SND_BUFFER_SAMPLE_SIZE, sampFreq);
+		multiResMapper.mapStereo(frameSpecLeft, frameSpecRight, lowLeft, lowRight);
+		for(int i=0; i<multiResLowBands; i++) {
+			frameBandLeft[i] = lowLeft[i];
+			frameBandRight[i] = lowRight[i];
+		}
+	} else if(features & SND_FEATURE_BANDS) {
+		bandMapper.setSpectrum(SND_BUFFER_SAMPLE_SIZE, sampFreq);
+		bandMapper.mapStereo(frameSpecLeft, frameSpecRight, frameBandLeft, frameBandRight);
+	} else {
+		skippedStages++;
+	}
+	
+	//spectrum history (one entry per new long window so the refresh rate doesn't stretch it)
+	if(!(features & SND_FEATURE_HISTORY)) skippedStages++;
+	else if(newAudio) appendHistory();
+	
+	//constant q (the fft is linear so the channels can be mixed in the spectrum)
+	if(features & SND_FEATURE_CHROMA) {
+		for(int i=0; i<(SND_BUFFER_SAMPLE_SIZE/2); i++) {
+			reLeft[i] = (reLeft[i] + reRight[i])*0.5f;
+			imLeft[i] = (imLeft[i] + imRight[i])*0.5f;
+		}
+		analyzeChroma(reLeft, imLeft);
+	} else {
+		skippedStages++;
+	}
+	
+	//onset and tempo tracking on the same frame (the beat phase is advanced every refresh)
+	if(features & SND_FEATURE_BEAT) {
+		beatTracker.setSpectrum(SND_BUFFER_SAMPLE_SIZE, sampFreq);
+		beatTracker.analyze(frameSpecLeft, frameSpecRight, longFrameTime);
+	} else {
+		skippedStages++;
+	}
+	longFrameTime = 0;
+	if(!(features & SND_FEATURE_LEVELS)) {
+		skippedStages++;
+		return;
+	}
+	
+	//calculate volume from the frame
+	float vuL = 0;
+	float vuR = 0;
+	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/2; i++) {
+		vuL += frameSpecLeft[i]/(float)(SND_BUFFER_SAMPLE_SIZE/2);
+		vuR += frameSpecRight[i]/(float)(SND_BUFFER_SAMPLE_SIZE/2);
+	}
+	frameVULeft = vuL;
+	frameVURight = vuR;
+	vuL = 0; vuR = 0;
+	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/24; i++) {
+		vuL += frameSpecLeft[i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+		vuR += frameSpecRight[i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+	}
+	frameBassLeft = vuL;
+	frameBassRight = vuR;
+	vuL = 0; vuR = 0;
+	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/24; i++) {
+		vuL += frameSpecLeft[((SND_BUFFER_SAMPLE_SIZE/2)/3) + i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+		vuR += frameSpecRight[((SND_BUFFER_SAMPLE_SIZE/2)/3) + i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+	}
+	frameMidLeft = vuL;
+	frameMidRight = vuR;
+	vuL = 0; vuR = 0;
+	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/24; i++) {
+		vuL += frameSpecLeft[((SND_BUFFER_SAMPLE_SIZE/2)/3)*2 + i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+		vuR += frameSpecRight[((SND_BUFFER_SAMPLE_SIZE/2)/3)*2 + i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+	}
+	frameTrebLeft = vuL;
+	frameTrebRight = vuR;
+}
+
+//! Moves the outputs toward the frame values with the attack/release envelopes
+void CSoundAnalyzer::applyEnvelopes()
+{
+	//wave (attack when the sample swings further out)
+	if(features & SND_FEATURE_WAVE_LEFT) {
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) {
+			float coef = (fabsf(frameWaveLeft[i]) > fabsf(waveLeft[i])) ? waveAttackCoef : waveReleaseCoef;
+			waveLeft[i] += (frameWaveLeft[i] - waveLeft[i])*coef;
+		}
+	}
+	if(features & SND_FEATURE_WAVE_RIGHT) {
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) {
+			float coef = (fabsf(frameWaveRight[i]) > fabsf(waveRight[i])) ? waveAttackCoef : waveReleaseCoef;
+			waveRight[i] += (frameWaveRight[i] - waveRight[i])*coef;
+		}
+	}
+	
+	//spectrum
+	if(features & SND_FEATURE_SPEC) {
+		for(int i=0; i<(SND_BUFFER_SAMPLE_SIZE/2); i++) {
+			specLeft[i] += (frameSpecLeft[i] - specLeft[i])*((frameSpecLeft[i] > specLeft[i]) ? specAttackCoef : specReleaseCoef);
+			specRight[i] += (frameSpecRight[i] - specRight[i])*((frameSpecRight[i] > specRight[i]) ? specAttackCoef : specReleaseCoef);
+		}
+	}
+	
+	//bands
+	if(features & SND_FEATURE_BANDS) {
+		for(int i=0; i<bandMapper.getNumBands(); i++) {
+			bandLeft[i] += (frameBandLeft[i] - bandLeft[i])*((frameBandLeft[i] > bandLeft[i]) ? bandAttackCoef : bandReleaseCoef);
+			bandRight[i] += (frameBandRight[i] - bandRight[i])*((frameBandRight[i] > bandRight[i]) ? bandAttackCoef : bandReleaseCoef);
+		}
+	}
+	
+	//constant q folded into pitch classes and scaled to the strongest (silence reads as all zero)
+	if(features & SND_FEATURE_CHROMA) {
+		for(int i=0; i<CQ_NUM_BINS; i++) {
+			cqBins[i] += (frameCQ[i] - cqBins[i])*((frameCQ[i] > cqBins[i]) ? bandAttackCoef : bandReleaseCoef);
+		}
+		CConstantQ::fold(cqBins, chroma);
+		chromaPeak = 0;
+		for(int i=1; i<CQ_BINS_PER_OCTAVE; i++) if(chroma[i] > chroma[chromaPeak]) chromaPeak = i;
+		float peak = chroma[chromaPeak];
+		for(int i=0; i<CQ_BINS_PER_OCTAVE; i++) chroma[i] = (peak > 1.0f) ? chroma[i]/peak : 0;
+	}
+	
+	//volume, bass, mid and treble
+	if(features & SND_FEATURE_LEVELS) {
+		vuLeft += (frameVULeft - vuLeft)*((frameVULeft > vuLeft) ? vuAttackCoef : vuReleaseCoef);
+		vuRight += (frameVURight - vuRight)*((frameVURight > vuRight) ? vuAttackCoef : vuReleaseCoef);
+		bassLeft += (frameBassLeft - bassLeft)*((frameBassLeft > bassLeft) ? bandAttackCoef : bandReleaseCoef);
+		bassRight += (frameBassRight - bassRight)*((frameBassRight > bassRight) ? bandAttackCoef : bandReleaseCoef);
+		midLeft += (frameMidLeft - midLeft)*((frameMidLeft > midLeft) ? bandAttackCoef : bandReleaseCoef);
+		midRight += (frameMidRight - midRight)*((frameMidRight > midRight) ? bandAttackCoef : bandReleaseCoef);
+		trebLeft += (frameTrebLeft - trebLeft)*((frameTrebLeft > trebLeft) ? bandAttackCoef : bandReleaseCoef);
+		trebRight += (frameTrebRight - trebRight)*((frameTrebRight > trebRight) ? bandAttackCoef : bandReleaseCoef);
 	}
+}
+
+//! Calculates the per refresh envelope coefficients for the elapsed time
+void CSoundAnalyzer::calcTimeCoefficients(double elapsedTime)
+{
+	coefElapsedTime = elapsedTime;
+	waveAttackCoef = timeCoefficient(waveAttack, elapsedTime);
+	waveReleaseCoef = timeCoefficient(waveRelease, elapsedTime);
+	specAttackCoef = timeCoefficient(specAttack, elapsedTime);
+	specReleaseCoef = timeCoefficient(specRelease, elapsedTime);
+	bandAttackCoef = timeCoefficient(bandAttack, elapsedTime);
+	bandReleaseCoef = timeCoefficient(bandRelease, elapsedTime);
+	vuAttackCoef = timeCoefficient(vuAttack, elapsedTime);
+	vuReleaseCoef = timeCoefficient(vuRelease, elapsedTime);
+	agcAttackCoef = timeCoefficient(agcAttack, elapsedTime);
+	agcReleaseCoef = timeCoefficient(agcRelease, elapsedTime);
+}
 
+//! Runs the spectrum analysis (fills the smoothed magnitude frame and the complex spectrum)
+void CSoundAnalyzer::analyzeSpectrum(float* frameLeft, float* frameRight, float* reLeft, float* imLeft, float* reRight, float* imRight)
+{
 	//spectrum analysis - fft
 	Complex complexDataLeft[SND_BUFFER_SAMPLE_SIZE];
 	Complex complexDataRight[SND_BUFFER_SAMPLE_SIZE];
@@ -175,63 +943,256 @@ void CSoundAnalyzer::refresh()
     fft(dataArrayLeft);
     fft(dataArrayRight);
 	
-	//spectrum analysis - smoothing (data mirrors at the middle after fft)
-	double smoothBufferL[2][(SND_BUFFER_SAMPLE_SIZE/2)];
-	double smoothBufferR[2][(SND_BUFFER_SAMPLE_SIZE/2)];
+	//spectrum analysis - magnitudes (data mirrors at the middle after fft)
+	float magLeft[(SND_BUFFER_SAMPLE_SIZE/2)];
+	float magRight[(SND_BUFFER_SAMPLE_SIZE/2)];
 	for(int i=0; i<(SND_BUFFER_SAMPLE_SIZE/2); i++) {
-		smoothBufferL[0][i] = std::abs(dataArrayLeft[i])/20.0;
-		if(smoothBufferL[0][i] > 32767) smoothBufferL[0][i] = 32767;
-		smoothBufferR[0][i] = std::abs(dataArrayRight[i])/20.0;
-		if(smoothBufferR[0][i] > 32767) smoothBufferR[0][i] = 32767;
-	}
-	for(int i=0; i<specSmoothPass; i++) {
-		int from = i%2;
-		int to = (i+1)%2;
-		smoothBufferL[to][0] = (smoothBufferL[from][0]+smoothBufferL[from][1])/3.0;
-		smoothBufferL[to][(SND_BUFFER_SAMPLE_SIZE/2)-1] = (smoothBufferL[from][(SND_BUFFER_SAMPLE_SIZE/2)-1]+smoothBufferL[from][(SND_BUFFER_SAMPLE_SIZE/2)-2])/3.0;
-		for(int j=1; j<(SND_BUFFER_SAMPLE_SIZE/2)-1; j++) smoothBufferL[to][j] = (smoothBufferL[from][j-1]+smoothBufferL[from][j]+smoothBufferL[from][j+1])/3.0;
-		smoothBufferR[to][0] = (smoothBufferR[from][0]+smoothBufferR[from][1])/3.0;
-		smoothBufferR[to][(SND_BUFFER_SAMPLE_SIZE/2)-1] = (smoothBufferR[from][(SND_BUFFER_SAMPLE_SIZE/2)-1]+smoothBufferR[from][(SND_BUFFER_SAMPLE_SIZE/2)-2])/3.0;
-		for(int j=1; j<(SND_BUFFER_SAMPLE_SIZE/2)-1; j++) smoothBufferR[to][j] = (smoothBufferR[from][j-1]+smoothBufferR[from][j]+smoothBufferR[from][j+1])/3.0;
-	}
-	int buff = specSmoothPass%2;
+		reLeft[i] = dataArrayLeft[i].real();
+		imLeft[i] = dataArrayLeft[i].imag();
+		reRight[i] = dataArrayRight[i].real();
+		imRight[i] = dataArrayRight[i].imag();
+		magLeft[i] = std::abs(dataArrayLeft[i])/20.0;
+		if(magLeft[i] > 32767) magLeft[i] = 32767;
+		magRight[i] = std::abs(dataArrayRight[i])/20.0;
+		if(magRight[i] > 32767) magRight[i] = 32767;
+	}
+	
+	//spectrum analysis - smoothing
+	smo_smooth(magLeft, frameLeft, SND_BUFFER_SAMPLE_SIZE/2, smoothKernel, smoothKernelSize);
+	smo_smooth(magRight, frameRight, SND_BUFFER_SAMPLE_SIZE/2, smoothKernel, smoothKernelSize);
+}
+
+//! Runs the short window spectrum and fills the bands above the crossover
+void CSoundAnalyzer::analyzeShortBands()
+{
+	//the short window ends on the newest samples, so the highs lead the lows by the long window's extra delay
+	unsigned int shortFreq = sampFreq*SND_MULTIRES_RATE_FACTOR;
+	if(shortFreq > snd_getBufferRate()) shortFreq = snd_getBufferRate();
+	short window[SND_MULTIRES_SHORT_SIZE*2];
+	snd_collectSamplesBefore(window, shortFreq, SND_MULTIRES_SHORT_SIZE*2, 0);
+	
+	//noise magnitude grows with the square root of the window length, so scale up to the long window's level (no smoothing)
+	float shortGain = sqrtf((float)SND_BUFFER_SAMPLE_SIZE/SND_MULTIRES_SHORT_SIZE);
+	float magLeft[(SND_MULTIRES_SHORT_SIZE/2)];
+	float magRight[(SND_MULTIRES_SHORT_SIZE/2)];
+	if(fixedPoint) {
+		for(int c=0; c<2; c++) {
+			float* mag = (c == 0) ? magLeft : magRight;
+			int fixedRe[SND_MULTIRES_SHORT_SIZE];
+			int fixedIm[SND_MULTIRES_SHORT_SIZE];
+			for(int i=0; i<SND_MULTIRES_SHORT_SIZE; i++) {
+				fixedRe[i] = (window[i*2 + c]*fixedHannShort[i] + (1 << 14)) >> 15;
+				fixedIm[i] = 0;
+			}
+			int exponent = fftFixed(fixedRe, fixedIm, SND_MULTIRES_SHORT_SIZE);
+			for(int i=0; i<(SND_MULTIRES_SHORT_SIZE/2); i++) {
+				mag[i] = fixedMagnitude(fixedRe[i], fixedIm[i], exponent)*shortGain;
+				if(mag[i] > 32767) mag[i] = 32767;
+			}
+		}
+	} else {
+		Complex complexDataLeft[SND_MULTIRES_SHORT_SIZE];
+		Complex complexDataRight[SND_MULTIRES_SHORT_SIZE];
+		for(int i=0; i<SND_MULTIRES_SHORT_SIZE; i++) {
+			double m = 0.5 * (1 - cos(2*PI*i/(SND_MULTIRES_SHORT_SIZE-1)));//hann function window
+			complexDataLeft[i] = std::complex<double>(m*(double)window[i*2 +0], 0.0);
+			complexDataRight[i] = std::complex<double>(m*(double)window[i*2 +1], 0.0);
+		}
+		CArray dataArrayLeft(complexDataLeft, SND_MULTIRES_SHORT_SIZE);
+		CArray dataArrayRight(complexDataRight, SND_MULTIRES_SHORT_SIZE);
+		fft(dataArrayLeft);
+		fft(dataArrayRight);
+		for(int i=0; i<(SND_MULTIRES_SHORT_SIZE/2); i++) {
+			magLeft[i] = std::abs(dataArrayLeft[i])*shortGain/20.0;
+			if(magLeft[i] > 32767) magLeft[i] = 32767;
+			magRight[i] = std::abs(dataArrayRight[i])*shortGain/20.0;
+			if(magRight[i] > 32767) magRight[i] = 32767;
+		}
+	}
+	float bandsLeft[BAND_MAX_BANDS];
+	float bandsRight[BAND_MAX_BANDS];
+	bandMapper.setSpectrum(SND_MULTIRES_SHORT_SIZE, shortFreq);
+	bandMapper.mapStereo(magLeft, magRight, bandsLeft, bandsRight);
+	
+	//bands that end below the crossover come from the long window (same edges, built once the layout is known)
+	int numBands = bandMapper.getNumBands();
+	if(multiResDirty) {
+		float edges[BAND_MAX_BANDS+1];
+		multiResLowBands = 0;
+		while(multiResLowBands < numBands && bandMapper.getBandEdge(multiResLowBands+1) <= SND_MULTIRES_CROSSOVER) multiResLowBands++;
+		for(int i=0; i<=multiResLowBands; i++) edges[i] = bandMapper.getBandEdge(i);
+		if(multiResLowBands > 0) multiResMapper.setLayout(BAND_LAYOUT_CUSTOM, multiResLowBands, edges);
+		multiResDirty = false;
+	}
+	for(int i=multiResLowBands; i<numBands; i++) {
+		frameBandLeft[i] = bandsLeft[i];
+		frameBandRight[i] = bandsRight[i];
+	}
+}
+
+//! Runs the spectrum analysis for one channel in fixed point
+void CSoundAnalyzer::analyzeSpectrumFixed(int channel, float* frame, float* re, float* im)
+{
+	//q15 window and fft with block floating point
+	int fixedRe[SND_BUFFER_SAMPLE_SIZE];
+	int fixedIm[SND_BUFFER_SAMPLE_SIZE];
+	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) {
+		fixedRe[i] = (waveRaw[i*2 + channel]*fixedHann[i] + (1 << 14)) >> 15;
+		fixedIm[i] = 0;
+	}
+	int exponent = fftFixed(fixedRe, fixedIm, SND_BUFFER_SAMPLE_SIZE);
+	
+	//integer magnitudes
+	int mags[(SND_BUFFER_SAMPLE_SIZE/2)];
 	for(int i=0; i<(SND_BUFFER_SAMPLE_SIZE/2); i++) {
-		specLeft[i] = specLeft[i]*(1.0-specTimeSmooth) + smoothBufferL[buff][i]*specTimeSmooth;
-		specRight[i] = specRight[i]*(1.0-specTimeSmooth) + smoothBufferR[buff][i]*specTimeSmooth;
-		specLeft[(SND_BUFFER_SAMPLE_SIZE-1)-i] = specLeft[i];
-		specRight[(SND_BUFFER_SAMPLE_SIZE-1)-i] = specRight[i];
+		re[i] = ldexpf(fixedRe[i], exponent);
+		im[i] = ldexpf(fixedIm[i], exponent);
+		mags[i] = fixedMagnitude(fixedRe[i], fixedIm[i], exponent);
 	}
 	
-	//calculate volume from spec data (data mirrors at the middle after fft)
-	float vuL = 0;
-	float vuR = 0;
-	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/2; i++) {
-		vuL += (float)specLeft[i]/(float)(SND_BUFFER_SAMPLE_SIZE/2);
-		vuR += (float)specRight[i]/(float)(SND_BUFFER_SAMPLE_SIZE/2);
+	//integer smoothing
+	int smoothed[(SND_BUFFER_SAMPLE_SIZE/2)];
+	smo_smoothFixed(mags, smoothed, SND_BUFFER_SAMPLE_SIZE/2, smoothKernelQ15, smoothKernelSize);
+	for(int i=0; i<(SND_BUFFER_SAMPLE_SIZE/2); i++) frame[i] = smoothed[i];
+}
+
+//! Converts the spectrum outputs after gain to the dB range
+void CSoundAnalyzer::calcSpectrumDB()
+{
+	if(!(features & SND_FEATURE_SPEC)) return;
+	
+	//dB = 20*log10(spec*gain/norm) folded into one multiply and add on log2(spec)
+	float range = dbCeiling - dbFloor;
+	float scale = DB_PER_OCTAVE/range;
+	float offset = (20.0f*log10f(agcGain/SND_NORM_SPEC) - dbFloor)/range;
+	fastLog2Map(specLeft, specDBLeft, SND_BUFFER_SAMPLE_SIZE/2, scale, offset);
+	fastLog2Map(specRight, specDBRight, SND_BUFFER_SAMPLE_SIZE/2, scale, offset);
+}
+
+//! Fills out with points from an output array (cached until the outputs change)
+void CSoundAnalyzer::resample(int source, int channel, int count, float* out, float start, float step, bool geometric, int interpolation)
+{
+	if(count <= 0) return;
+	
+	//visualizers asking for the same points since the last refresh get a copy
+	bool cacheable = (count <= SND_RESAMPLE_CACHE_POINTS);
+	if(cacheable) {
+		for(int e=0; e<SND_RESAMPLE_CACHE_ENTRIES; e++) {
+			ResampleEntry& entry = resampleCache[e];
+			if(entry.sequence == outputSequence && entry.source == source && entry.channel == channel && entry.count == count &&
+					entry.start == start && entry.step == step && entry.geometric == geometric && entry.interpolation == interpolation) {
+				for(int i=0; i<count; i++) out[i] = entry.points[i];
+				return;
+			}
+		}
 	}
-	vuLeft = vuL;
-	vuRight = vuR;
-	vuL = 0; vuR = 0;
-	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/24; i++) {
-		vuL += (float)specLeft[i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
-		vuR += (float)specRight[i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+	
+	const float* data;
+	int size;
+	float scale;
+	float min = 0.0f;
+	if(source == RESAMPLE_SOURCE_WAVE) {
+		data = (channel == SND_CHANNEL_RIGHT) ? waveRight : waveLeft;
+		size = SND_BUFFER_SAMPLE_SIZE;
+		scale = agcGain/SND_NORM_WAVE;
+		min = -1.0f;
+	} else if(source == RESAMPLE_SOURCE_SPEC) {
+		data = (channel == SND_CHANNEL_RIGHT) ? specRight : specLeft;
+		size = SND_BUFFER_SAMPLE_SIZE/2;
+		scale = agcGain/SND_NORM_SPEC;
+	} else if(source == RESAMPLE_SOURCE_SPEC_DB) {
+		data = (channel == SND_CHANNEL_RIGHT) ? specDBRight : specDBLeft;
+		size = SND_BUFFER_SAMPLE_SIZE/2;
+		scale = 1.0f;
+	} else {
+		data = (channel == SND_CHANNEL_RIGHT) ? bandRight : bandLeft;
+		size = bandMapper.getNumBands();
+		scale = agcGain/SND_NORM_BAND;
 	}
-	bassLeft = vuL;
-	bassRight = vuR;
-	vuL = 0; vuR = 0;
-	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/24; i++) {
-		vuL += (float)specLeft[((SND_BUFFER_SAMPLE_SIZE/2)/3) + i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
-		vuR += (float)specRight[((SND_BUFFER_SAMPLE_SIZE/2)/3) + i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+	
+	//gather the points (positions clamped to the array like the per index getters, one loop per mode to keep them branch free)
+	float last = (float)(size-1);
+	if(interpolation == SND_RESAMPLE_LINEAR && geometric) {
+		float position = start;
+		for(int i=0; i<count; i++) {
+			float p = (position < 0.0f) ? 0.0f : ((position > last) ? last : position);
+			int index = (int)p;
+			int next = (index < size-1) ? index+1 : index;
+			out[i] = data[index] + (data[next] - data[index])*(p - index);
+			position *= step;
+		}
+	} else if(interpolation == SND_RESAMPLE_LINEAR) {
+		for(int i=0; i<count; i++) {
+			float p = start + i*step;
+			p = (p < 0.0f) ? 0.0f : ((p > last) ? last : p);
+			int index = (int)p;
+			int next = (index < size-1) ? index+1 : index;
+			out[i] = data[index] + (data[next] - data[index])*(p - index);
+		}
+	} else if(geometric) {
+		float position = start;
+		for(int i=0; i<count; i++) {
+			float p = (position < 0.0f) ? 0.0f : ((position > last) ? last : position);
+			out[i] = data[(int)p];
+			position *= step;
+		}
+	} else {
+		for(int i=0; i<count; i++) {
+			float p = start + i*step;
+			p = (p < 0.0f) ? 0.0f : ((p > last) ? last : p);
+			out[i] = data[(int)p];
+		}
 	}
-	midLeft = vuL;
-	midRight = vuR;
-	vuL = 0; vuR = 0;
-	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/24; i++) {
-		vuL += (float)specLeft[((SND_BUFFER_SAMPLE_SIZE/2)/3)*2 + i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
-		vuR += (float)specRight[((SND_BUFFER_SAMPLE_SIZE/2)/3)*2 + i]/(float)(SND_BUFFER_SAMPLE_SIZE/24);
+	
+	//gain and range in a separate pass without lookups (vectorizes)
+	for(int i=0; i<count; i++) {
+		float value = out[i]*scale;
+		out[i] = (value < min) ? min : ((value > 1.0f) ? 1.0f : value);
+	}
+	
+	if(cacheable) {
+		ResampleEntry& entry = resampleCache[resampleNext];
+		resampleNext = (resampleNext + 1)%SND_RESAMPLE_CACHE_ENTRIES;
+		entry.source = source;
+		entry.channel = channel;
+		entry.count = count;
+		entry.start = start;
+		entry.step = step;
+		entry.geometric = geometric;
+		entry.interpolation = interpolation;
+		entry.sequence = outputSequence;
+		for(int i=0; i<count; i++) entry.points[i] = out[i];
+	}
+}
+
+//! Appends the current spectrum frame to the history ring (the oldest frame is overwritten when full)
+void CSoundAnalyzer::appendHistory()
+{
+	if(historySize <= 0) return;
+	int numBands = historyMapper.getNumBands();
+	float bandsLeft[BAND_MAX_BANDS];
+	float bandsRight[BAND_MAX_BANDS];
+	historyMapper.setSpectrum(SND_BUFFER_SAMPLE_SIZE, sampFreq);
+	historyMapper.mapStereo(frameSpecLeft, frameSpecRight, bandsLeft, bandsRight);
+	
+	//advance the head over the oldest slot instead of shifting the frames
+	historyHead = (historyHead + 1)%historySize;
+	if(historyLength < historySize) historyLength++;
+	short* slot = history + historyHead*numBands*2;
+	for(int i=0; i<numBands; i++) {
+		slot[i] = (bandsLeft[i] > 32767) ? 32767 : bandsLeft[i];
+		slot[numBands + i] = (bandsRight[i] > 32767) ? 32767 : bandsRight[i];
+	}
+}
+
+//! Runs the constant q transform on the mono complex spectrum
+void CSoundAnalyzer::analyzeChroma(const float* re, const float* im)
+{
+	constantQ.setSpectrum(SND_BUFFER_SAMPLE_SIZE, sampFreq);
+	constantQ.transform(re, im, frameCQ);
+	for(int i=0; i<CQ_NUM_BINS; i++) {
+		if(frameCQ[i] > 32767) frameCQ[i] = 32767;
 	}
-	trebLeft = vuL;
-	trebRight = vuR;
 }
 
 //FFT functions (https://rosettacode.org/wiki/Fast_Fourier_transform)
@@ -256,3 +1217,154 @@ static void fft(CArray& x)
         x[k+N/2] = even[k] - t;
     }
 }
+
+//Fixed point FFT functions (q15 twiddles, block floating point)
+static void fftFixedInit()
+{
+	int bits = 0;
+	while((1 << bits) < SND_BUFFER_SAMPLE_SIZE) bits++;
+	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) {
+		fixedHann[i] = toQ15(0.5 * (1 - cos(2*PI*i/(SND_BUFFER_SAMPLE_SIZE-1)))*(32767.0/32768.0));
+		int r = 0;
+		for(int b=0; b<bits; b++) if(i & (1 << b)) r |= 1 << ((bits-1)-b);
+		fixedBitReverse[i] = r;
+	}
+	for(int i=0; i<SND_MULTIRES_SHORT_SIZE; i++) {
+		fixedHannShort[i] = toQ15(0.5 * (1 - cos(2*PI*i/(SND_MULTIRES_SHORT_SIZE-1)))*(32767.0/32768.0));
+	}
+	for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/2; i++) {
+		fixedCos[i] = toQ15(cos(2*PI*i/SND_BUFFER_SAMPLE_SIZE)*(32767.0/32768.0));
+		fixedSin[i] = toQ15(sin(2*PI*i/SND_BUFFER_SAMPLE_SIZE)*(32767.0/32768.0));
+	}
+}
+static int fftFixed(int* re, int* im, int n)
+{
+	//shorter power of two sizes reuse the full size tables (bit reverse drops the low bits, twiddles are strided)
+	int reverseShift = 0;
+	while((n << reverseShift) < SND_BUFFER_SAMPLE_SIZE) reverseShift++;
+	for(int i=0; i<n; i++) {
+		int j = fixedBitReverse[i] >> reverseShift;
+		if(j > i) {
+			int t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+	
+	int exponent = 0;
+	for(int size=2; size<=n; size*=2) {
+		
+		//keep the block under 2^14 so the twiddle products fit in 32 bits
+		int peak = 0;
+		for(int i=0; i<n; i++) {
+			int a = (re[i] < 0) ? -re[i] : re[i];
+			int b = (im[i] < 0) ? -im[i] : im[i];
+			if(a > peak) peak = a;
+			if(b > peak) peak = b;
+		}
+		int shift = 0;
+		while((peak >> shift) >= (1 << 14)) shift++;
+		if(shift > 0) {
+			for(int i=0; i<n; i++) {
+				re[i] = (re[i] + (1 << (shift-1))) >> shift;
+				im[i] = (im[i] + (1 << (shift-1))) >> shift;
+			}
+			exponent += shift;
+		}
+		
+		//butterflies
+		int half = size/2;
+		int step = SND_BUFFER_SAMPLE_SIZE/size;
+		for(int start=0; start<n; start+=size) {
+			for(int k=0; k<half; k++) {
+				int c = fixedCos[k*step];
+				int s = fixedSin[k*step];
+				int a = start + k;
+				int b = a + half;
+				int tr = (re[b]*c + im[b]*s + (1 << 14)) >> 15;
+				int ti = (im[b]*c - re[b]*s + (1 << 14)) >> 15;
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+	return exponent;
+}
+static int fixedMagnitude(int re, int im, int exponent)
+{
+	//integer magnitude (alpha max plus beta min) scaled back by the block exponent and /20
+	int a = (re < 0) ? -re : re;
+	int b = (im < 0) ? -im : im;
+	int mag = (a > b) ? (FIXED_MAG_ALPHA*a + FIXED_MAG_BETA*b) >> 15 : (FIXED_MAG_ALPHA*b + FIXED_MAG_BETA*a) >> 15;
+	mag *= FIXED_DIV_20;
+	if(exponent >= 16) mag = (mag > (32767 >> (exponent-16))) ? 32767 : mag << (exponent-16);
+	else mag = (mag + (1 << (15-exponent))) >> (16-exponent);
+	return (mag > 32767) ? 32767 : mag;
+}
+static int toQ15(float value)
+{
+	if(value >= 1.0f) return 32768;
+	if(value <= -1.0f) return -32768;
+	return (int)(value*32768.0f + ((value < 0) ? -0.5f : 0.5f));
+}
+
+//Envelope and gain functions
+static float timeCoefficient(float timeConstant, double elapsedTime)
+{
+	//one pole response to a step after elapsedTime (1.0 follows the input immediately)
+	if(timeConstant <= 0) return 1.0f;
+	return 1.0f - (float)exp(-elapsedTime/timeConstant);
+}
+static float normalize(float value, float scale, float min)
+{
+	value *= scale;
+	if(value < min) return min;
+	if(value > 1.0f) return 1.0f;
+	return value;
+}
+static float normalizeLevel(float value, float scale)
+{
+	//levels are left unclamped above 1.0 so loud passages still drive the visuals harder
+	value *= scale;
+	if(value < 0.0f) return 0.0f;
+	return value;
+}
+static void fastLog2Map(const float* in, float* out, int n, float scale, float offset)
+{
+	//log2 from the float's exponent plus a quadratic on the mantissa (within 0.005, so 0.03dB), four bins per step
+	int i = 0;
+#if defined(SND_SIMD_NEON)
+	for(; i+4<=n; i+=4) {
+		uint32x4_t bits = vreinterpretq_u32_f32(vaddq_f32(vld1q_f32(in + i), vdupq_n_f32(1e-20f)));
+		float32x4_t exponent = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+		float32x4_t mantissa = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+		float32x4_t poly = vaddq_f32(vmulq_f32(vdupq_n_f32(-0.34484843f), mantissa), vdupq_n_f32(2.02466578f));
+		float32x4_t log2 = vsubq_f32(vaddq_f32(exponent, vmulq_f32(poly, mantissa)), vdupq_n_f32(1.67487759f));
+		float32x4_t mapped = vaddq_f32(vmulq_f32(log2, vdupq_n_f32(scale)), vdupq_n_f32(offset));
+		vst1q_f32(out + i, vminq_f32(vmaxq_f32(mapped, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f)));
+	}
+#elif defined(SND_SIMD_SSE2)
+	for(; i+4<=n; i+=4) {
+		__m128i bits = _mm_castps_si128(_mm_add_ps(_mm_loadu_ps(in + i), _mm_set1_ps(1e-20f)));
+		__m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+		__m128 mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+		__m128 poly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.34484843f), mantissa), _mm_set1_ps(2.02466578f));
+		__m128 log2 = _mm_sub_ps(_mm_add_ps(exponent, _mm_mul_ps(poly, mantissa)), _mm_set1_ps(1.67487759f));
+		__m128 mapped = _mm_add_ps(_mm_mul_ps(log2, _mm_set1_ps(scale)), _mm_set1_ps(offset));
+		_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(mapped, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+	}
+#endif
+	for(; i<n; i++) {
+		float value = in[i] + 1e-20f; //magnitudes are never negative, keeps silence finite
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		float exponent = (float)((int)(bits >> 23) - 127);
+		bits = (bits & 0x007FFFFF) | 0x3F800000;
+		float mantissa;
+		memcpy(&mantissa, &bits, sizeof(mantissa));
+		float log2 = exponent + (-0.34484843f*mantissa + 2.02466578f)*mantissa - 1.67487759f;
+		float mapped = log2*scale + offset;
+		out[i] = (mapped < 0.0f) ? 0.0f : ((mapped > 1.0f) ? 1.0f : mapped);
+	}
+}
@@ -6,13 +6,72 @@
 #ifndef SOUND_ANALYZER_H
 #define SOUND_ANALYZER_H
 
+#include "CBandMapper.h"
+#include "CBeatTracker.h"
+#include "CConstantQ.h"
+#include "core/fbk.h"
+#include "core/smo.h"
+
 #define SND_BUFFER_SAMPLE_SIZE 512
 
 #define SND_DEFAULT_SAMPLE_FREQUENCY 6000
 #define SND_DEFAULT_WAVE_LP_FILTER 1.0
-#define SND_DEFAULT_WAVE_TIME_SMOOTH 1.0
 #define SND_DEFAULT_SPEC_SMOOTH_PASS 0
-#define SND_DEFAULT_SPEC_TIME_SMOOTH 1.0
+#define SND_DEFAULT_WAVE_ATTACK 0.0
+#define SND_DEFAULT_WAVE_RELEASE 0.0
+#define SND_DEFAULT_SPEC_ATTACK 0.0
+#define SND_DEFAULT_SPEC_RELEASE 0.0
+#define SND_DEFAULT_BAND_ATTACK 0.0
+#define SND_DEFAULT_BAND_RELEASE 0.0
+#define SND_DEFAULT_VU_ATTACK 0.0
+#define SND_DEFAULT_VU_RELEASE 0.0
+#define SND_DEFAULT_FIXED_POINT false
+#define SND_DEFAULT_BAND_LAYOUT BAND_LAYOUT_LOG
+#define SND_DEFAULT_NUM_BANDS 32
+#define SND_DEFAULT_AGC true
+#define SND_DEFAULT_AGC_TARGET -23.0
+#define SND_DEFAULT_AGC_ATTACK 0.5
+#define SND_DEFAULT_AGC_RELEASE 5.0
+#define SND_COEF_TIME_TOLERANCE 0.01    //frame times within this fraction of the last one reuse its envelope coefficients
+#define SND_AGC_GATE -50.0f
+#define SND_AGC_MIN_GAIN 0.25f
+#define SND_AGC_MAX_GAIN 16.0f
+#define SND_NORM_WAVE 16384.0f
+#define SND_NORM_SPEC 12000.0f
+#define SND_NORM_BAND 12000.0f
+#define SND_NORM_VU 3000.0f
+#define SND_NORM_ENVELOPE 0.25f
+#define SND_DEFAULT_DB_FLOOR -60.0f
+#define SND_DEFAULT_DB_CEILING 0.0f
+#define SND_DEFAULT_MULTI_RESOLUTION false
+#define SND_MULTIRES_SHORT_SIZE 128
+#define SND_MULTIRES_RATE_FACTOR 4
+#define SND_MULTIRES_CROSSOVER 1500.0f
+#define SND_MULTIRES_LONG_INTERVAL 2
+#define SND_DEFAULT_HISTORY_LAYOUT BAND_LAYOUT_LOG
+#define SND_DEFAULT_HISTORY_BANDS 32
+#define SND_DEFAULT_HISTORY_BUDGET 16384
+#define SND_RESAMPLE_CACHE_ENTRIES 4
+#define SND_RESAMPLE_CACHE_POINTS 512
+
+#define SND_CHANNEL_LEFT 0
+#define SND_CHANNEL_RIGHT 1
+
+#define SND_SPACING_LINEAR 0
+#define SND_SPACING_LOG 1
+
+#define SND_RESAMPLE_POINT 0
+#define SND_RESAMPLE_LINEAR 1
+
+#define SND_FEATURE_WAVE_LEFT 0x01
+#define SND_FEATURE_WAVE_RIGHT 0x02
+#define SND_FEATURE_SPEC 0x04
+#define SND_FEATURE_BANDS 0x08
+#define SND_FEATURE_LEVELS 0x10
+#define SND_FEATURE_BEAT 0x20
+#define SND_FEATURE_CHROMA 0x40
+#define SND_FEATURE_HISTORY 0x80
+#define SND_FEATURE_ALL 0xFF
 
 
 //! Class that does all sound data processing
@@ -21,6 +80,9 @@ class CSoundAnalyzer
 public:
 	//! Main constructor
 	CSoundAnalyzer();
+
+	//! Destructor
+	~CSoundAnalyzer();
 	
 	//! Sets the sampling frequency
 	void setSamplingFrequency(unsigned int sampFreq);
@@ -28,14 +90,56 @@ public:
 	//! Sets the low pass filter value on wave data (1.0 = off)
 	void setWaveLPF(float waveLPF);
 	
-	//! Sets the time smooth value for wave data (1.0 = off)
-	void setWaveTimeSmooth(float waveTimeSmooth);
-	
 	//! Sets the smooth factor for spectrum data
 	void setSpecSmoothPass(unsigned char specSmoothPass);
 	
-	//! Sets the time smooth value for spectrum data (1.0 = off)
-	void setSpecTimeSmooth(float specTimeSmooth);
+	//! Sets the attack and release time constants for wave data in seconds (0 = off)
+	void setWaveTimeConstants(float attack, float release);
+	
+	//! Sets the attack and release time constants for spectrum data in seconds (0 = off)
+	void setSpecTimeConstants(float attack, float release);
+	
+	//! Sets the attack and release time constants for bands, bass, mid and treble in seconds (0 = off)
+	void setBandTimeConstants(float attack, float release);
+	
+	//! Sets the attack and release time constants for volume in seconds (0 = off)
+	void setVUTimeConstants(float attack, float release);
+	
+	//! Sets the fixed point (q15) analysis path on or off (for cpus without fast double math)
+	//! Spectrum stays within 5% of the float value + 0.2% of the frame peak + 2, waves within +/-5
+	//! Band mapping, levels (vu) and chroma still run in float off the fixed point spectrum
+	void setFixedPoint(bool fixedPoint);
+	
+	//! Sets the multi-resolution bands on or off (bands above the crossover come from a short window at a higher rate)
+	//! The band layout then spans up to the short window's nyquist and the long window only runs every other frame
+	void setMultiResolution(bool multiResolution);
+
+	//! Sets the levels in dB (after gain, 0dB = full scale of the normalized spectrum) mapped to 0.0 and 1.0 by the dB spectrum
+	void setDBRange(float floor, float ceiling);
+
+	//! Sets the automatic gain control on or off (scales the normalized outputs)
+	void setAGC(bool agc);
+	
+	//! Sets the short-term loudness the automatic gain control aims for (LUFS)
+	void setAGCTarget(float loudness);
+	
+	//! Sets the attack (gain falling) and release (gain rising) time constants for the automatic gain in seconds
+	void setAGCTimeConstants(float attack, float release);
+	
+	//! Sets the analysis features to run on refresh (SND_FEATURE_* flags, the rest hold their last values)
+	void setFeatures(int features);
+	
+	//! Gets the analysis features run on refresh
+	int getFeatures();
+	
+	//! Gets the number of analysis stages skipped so far because no feature needed them
+	unsigned int getSkippedStages();
+	
+	//! Gets the number of refreshes so far that reused the last analysis because no new audio had arrived
+	unsigned int getRedundantRefreshes();
+	
+	//! Sets the band layout and number of bands (custom layouts take numBands+1 ascending edges in Hz up to the nyquist, others fall back to log)
+	void setBandLayout(int layout, int numBands, const float* edges = 0);
 	
 	//! Gets the left waveform samples
 	short getWaveLeft(int index);
@@ -49,6 +153,15 @@ public:
 	//! Gets the right spectrum samples
 	short getSpecRight(int index);
 	
+	//! Gets the number of bands in the band layout
+	int getNumBands();
+	
+	//! Gets the left band values
+	short getBandLeft(int band);
+	
+	//! Gets the right band values
+	short getBandRight(int band);
+	
 	//! Gets the left bass value
 	int getBassLeft();
 	
@@ -72,30 +185,277 @@ public:
 	
 	//! Gets the right channel volume
 	int getVURight();
+	
+	//! Gets if an onset was detected in the last refresh
+	bool getOnset();
+	
+	//! Gets if a beat occurred in the last refresh
+	bool getBeat();
+	
+	//! Gets the phase within the current beat (0.0 on the beat to 1.0)
+	float getBeatPhase();
+	
+	//! Gets the estimated tempo in beats per minute
+	float getBpm();
+	
+	//! Gets the left channel time domain rms level (0.0 to 1.0 of full scale)
+	float getRMSLeft();
+	
+	//! Gets the right channel time domain rms level (0.0 to 1.0 of full scale)
+	float getRMSRight();
+	
+	//! Gets the K-weighted short-term loudness (LUFS)
+	float getLoudness();
+	
+	//! Gets the current automatic gain
+	float getAGCGain();
+	
+	//! Gets a filterbank envelope (FBK_BAND_*) straight from the sound thread, a few ms old (0.0 to 1.0 of full scale)
+	float getEnvelope(int band);
+	
+	//! Gets the left waveform samples after gain (-1.0 to 1.0)
+	float getWaveLeftNorm(int index);
+	
+	//! Gets the right waveform samples after gain (-1.0 to 1.0)
+	float getWaveRightNorm(int index);
+	
+	//! Gets the left spectrum samples after gain (0.0 to 1.0)
+	float getSpecLeftNorm(int index);
+	
+	//! Gets the right spectrum samples after gain (0.0 to 1.0)
+	float getSpecRightNorm(int index);
+	
+	//! Gets the left spectrum samples after gain in dB mapped from the dB range (0.0 to 1.0)
+	float getSpecLeftDB(int index);
+	
+	//! Gets the right spectrum samples after gain in dB mapped from the dB range (0.0 to 1.0)
+	float getSpecRightDB(int index);
+	
+	//! Gets the left band values after gain (0.0 to 1.0)
+	float getBandLeftNorm(int band);
+	
+	//! Gets the right band values after gain (0.0 to 1.0)
+	float getBandRightNorm(int band);
+	
+	//! Gets the left bass value after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getBassLeftNorm();
+	
+	//! Gets the right bass value after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getBassRightNorm();
+	
+	//! Gets the left mid value after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getMidLeftNorm();
+	
+	//! Gets the right mid value after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getMidRightNorm();
+	
+	//! Gets the left treble value after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getTrebLeftNorm();
+	
+	//! Gets the right treble value after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getTrebRightNorm();
+	
+	//! Gets the left channel volume after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getVULeftNorm();
+	
+	//! Gets the right channel volume after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getVURightNorm();
+	
+	//! Gets a filterbank envelope (FBK_BAND_*) after gain (0.0 up, 1.0 at full level and above it when louder)
+	float getEnvelopeNorm(int band);
+	
+	//! Gets the constant q (semitone) bin values (bin 0 is C3)
+	short getCQ(int bin);
+	
+	//! Gets the center frequency of a constant q bin in Hz
+	float getCQFrequency(int bin);
+	
+	//! Gets the chroma value of a pitch class (0 = C, wraps around) relative to the strongest one (0.0 to 1.0)
+	float getChroma(int pitchClass);
+	
+	//! Gets the strongest pitch class (0 = C)
+	int getChromaPeak();
+
+	//! Sets the band layout and number of bands kept in the spectrum history (clears the history)
+	void setHistoryLayout(int layout, int numBands);
+
+	//! Sets the memory the spectrum history may use in bytes (sets the number of frames kept, clears the history)
+	void setHistoryBudget(unsigned int bytes);
+
+	//! Gets the number of bands in each spectrum history frame
+	int getHistoryNumBands();
+
+	//! Gets the number of frames the spectrum history can hold
+	int getHistorySize();
+
+	//! Gets the number of frames currently in the spectrum history
+	int getHistoryLength();
 
-	//! Refreshes the sound data
-	void refresh();
+	//! Gets a left band value from the spectrum history (age 0 is the newest frame, 0 past the oldest)
+	short getHistoryLeft(int age, int band);
+
+	//! Gets a right band value from the spectrum history (age 0 is the newest frame, 0 past the oldest)
+	short getHistoryRight(int age, int band);
+
+	//! Gets a left band value from the spectrum history after gain (0.0 to 1.0)
+	float getHistoryLeftNorm(int age, int band);
+
+	//! Gets a right band value from the spectrum history after gain (0.0 to 1.0)
+	float getHistoryRightNorm(int age, int band);
+
+	//! Fills out with count waveform points after gain (-1.0 to 1.0) taken at start + i*step samples
+	//! Point interpolation takes the sample at or before each position (like casting the index for getWaveLeftNorm)
+	void getWave(int channel, int count, float* out, float start, float step, int interpolation = SND_RESAMPLE_POINT);
+
+	//! Fills out with count spectrum points after gain (0.0 to 1.0) spread over the spectrum (log spacing starts at bin 1)
+	void getSpectrum(int channel, int count, float* out, int spacing = SND_SPACING_LINEAR, int interpolation = SND_RESAMPLE_LINEAR);
+
+	//! Fills out with count dB spectrum points (0.0 to 1.0) spread over the spectrum (log spacing starts at bin 1)
+	void getSpectrumDB(int channel, int count, float* out, int spacing = SND_SPACING_LINEAR, int interpolation = SND_RESAMPLE_LINEAR);
+
+	//! Fills out with count band values after gain (0.0 to 1.0) spread evenly over the band layout
+	void getBands(int channel, int count, float* out, int interpolation = SND_RESAMPLE_POINT);
+
+	//! Refreshes the sound data (given time since the last refresh in seconds)
+	void refresh(double elapsedTime);
 
 private:
 	short waveRaw[SND_BUFFER_SAMPLE_SIZE*2];
-	short waveLeft[SND_BUFFER_SAMPLE_SIZE];
-	short waveRight[SND_BUFFER_SAMPLE_SIZE];
-	short specLeft[SND_BUFFER_SAMPLE_SIZE];
-	short specRight[SND_BUFFER_SAMPLE_SIZE];
-	int bassLeft;
-	int midLeft;
-	int trebLeft;
-	int vuLeft;
-	int bassRight;
-	int midRight;
-	int trebRight;
-	int vuRight;
+	float waveLeft[SND_BUFFER_SAMPLE_SIZE];
+	float waveRight[SND_BUFFER_SAMPLE_SIZE];
+	float specLeft[SND_BUFFER_SAMPLE_SIZE/2];
+	float specRight[SND_BUFFER_SAMPLE_SIZE/2];
+	float specDBLeft[SND_BUFFER_SAMPLE_SIZE/2];
+	float specDBRight[SND_BUFFER_SAMPLE_SIZE/2];
+	float bandLeft[BAND_MAX_BANDS];
+	float bandRight[BAND_MAX_BANDS];
+	float frameWaveLeft[SND_BUFFER_SAMPLE_SIZE];
+	float frameWaveRight[SND_BUFFER_SAMPLE_SIZE];
+	float frameSpecLeft[SND_BUFFER_SAMPLE_SIZE/2];
+	float frameSpecRight[SND_BUFFER_SAMPLE_SIZE/2];
+	float frameBandLeft[BAND_MAX_BANDS];
+	float frameBandRight[BAND_MAX_BANDS];
+	float frameCQ[CQ_NUM_BINS];
+	float frameBassLeft;
+	float frameMidLeft;
+	float frameTrebLeft;
+	float frameVULeft;
+	float frameBassRight;
+	float frameMidRight;
+	float frameTrebRight;
+	float frameVURight;
+	unsigned int frameSequence;
+	int frameFeatures;
+	double frameTime;
+	float cqBins[CQ_NUM_BINS];
+	float chroma[CQ_BINS_PER_OCTAVE];
+	int chromaPeak;
+	CBandMapper historyMapper;
+	short* history;
+	struct ResampleEntry {
+		int source;
+		int channel;
+		int count;
+		float start;
+		float step;
+		bool geometric;
+		int interpolation;
+		unsigned int sequence;
+		float points[SND_RESAMPLE_CACHE_POINTS];
+	};
+	ResampleEntry resampleCache[SND_RESAMPLE_CACHE_ENTRIES];
+	int resampleNext;
+	unsigned int outputSequence;
+	unsigned int historyBudget;
+	int historySize;
+	int historyLength;
+	int historyHead;
+	float bassLeft;
+	float midLeft;
+	float trebLeft;
+	float vuLeft;
+	float bassRight;
+	float midRight;
+	float trebRight;
+	float vuRight;
 	
 	unsigned int sampFreq;
 	float waveLPF;
-	float waveTimeSmooth;
 	unsigned char specSmoothPass;
-	float specTimeSmooth;
+	int smoothKernelSize;
+	float smoothKernel[SMO_MAX_PASSES+1];
+	int smoothKernelQ15[SMO_MAX_PASSES+1];
+	bool fixedPoint;
+	bool multiResolution;
+	bool multiResDirty;
+	int multiResLowBands;
+	int longSkips;
+	double longFrameTime;
+	CBandMapper multiResMapper;
+	int waveLPFQ15;
+	int features;
+	unsigned int skippedStages;
+	unsigned int redundantRefreshes;
+	CBandMapper bandMapper;
+	CBeatTracker beatTracker;
+	CConstantQ constantQ;
+	
+	float waveAttack;
+	float waveRelease;
+	float specAttack;
+	float specRelease;
+	float bandAttack;
+	float bandRelease;
+	float vuAttack;
+	float vuRelease;
+	bool agc;
+	float agcTarget;
+	float agcAttack;
+	float agcRelease;
+	float agcGain;
+	float dbFloor;
+	float dbCeiling;
+	double coefElapsedTime;
+	float waveAttackCoef;
+	float waveReleaseCoef;
+	float specAttackCoef;
+	float specReleaseCoef;
+	float bandAttackCoef;
+	float bandReleaseCoef;
+	float vuAttackCoef;
+	float vuReleaseCoef;
+	float agcAttackCoef;
+	float agcReleaseCoef;
+	
+	//! Calculates the per refresh envelope coefficients for the elapsed time
+	void calcTimeCoefficients(double elapsedTime);
+	
+	//! Analyzes the collected samples into the frame values for the requested features (newAudio when not analyzed before)
+	void analyzeFrame(bool newAudio);
+	
+	//! Moves the outputs toward the frame values with the attack/release envelopes
+	void applyEnvelopes();
+	
+	//! Converts the spectrum outputs after gain to the dB range
+	void calcSpectrumDB();
+	
+	//! Runs the spectrum analysis (fills the smoothed magnitude frame and the complex spectrum)
+	void analyzeSpectrum(float* frameLeft, float* frameRight, float* reLeft, float* imLeft, float* reRight, float* imRight);
+	
+	//! Runs the short window spectrum and fills the bands above the crossover
+	void analyzeShortBands();
+
+	//! Runs the spectrum analysis for one channel in fixed point
+	void analyzeSpectrumFixed(int channel, float* frame, float* re, float* im);
+	
+	//! Fills out with points from an output array (cached until the outputs change)
+	void resample(int source, int channel, int count, float* out, float start, float step, bool geometric, int interpolation);
+
+	//! Appends the current spectrum frame to the history ring (the oldest frame is overwritten when full)
+	void appendHistory();
+
+	//! Runs the constant q transform on the mono complex spectrum
+	void analyzeChroma(const float* re, const float* im);
 };
 
 #endif
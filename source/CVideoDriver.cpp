@@ -6,9 +6,76 @@
 #include "CVideoDriver.h"
 #include "led.h"
 #include <limits.h>
+#include <string.h>
+#include <math.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VIDEO_SIMD_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VIDEO_SIMD_SSE2
+#endif
 
 #define ABS(a) (((a)<0) ? -(a) : (a))
 #define ZSGN(a) (((a)<0) ? -1 : (a)>0 ? 1 : 0)
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_HALF (1 << (FIXED_SHIFT-1))
+#define TILE_DRAWN 1        //drawn on since the last flush
+#define TILE_COVERED 2      //drawn on since the last clear
+#define TILE_PUSH 4         //sent to the display on the next flush even if unchanged
+#define TILE_PUSH_NEXT 8    //and on the flush after that
+#define TILE_CHANGED 16     //changed in the flush being sent
+
+//! Polygon edge walked one row at a time (x and color in 16.16 fixed point)
+struct ScanEdge {
+	int yTop;
+	int yBottom;
+	int x;              //x at the current row
+	int step;           //change in x per row
+	int xMin;           //x extent of the whole edge
+	int xMax;
+	int color[3];       //color at the current row
+	int colorStep[3];   //change in color per row
+	Color colorMin;     //colors at the ends of a flat edge
+	Color colorMax;
+	int coverStep;      //change in coverage per pixel across the edge (smooth edges only)
+	int fringe;         //half width of the coverage ramp across the edge (smooth edges only)
+};
+static void edgeSetup(ScanEdge& edge, Vector top, Color topColor, Vector bottom, Color bottomColor, int y);
+static void edgeCover(ScanEdge& edge, int y, int& left, int& right, Color& leftColor, Color& rightColor);
+static void edgeStep(ScanEdge& edge);
+static Color edgeColor(const ScanEdge& edge);
+static void segmentNormal(Vector a, Vector b, float* normal);
+static bool strokeJoint(const float* normal0, const float* normal1, float halfWidth, float* offset);
+static bool quadConvex(const int* x, const int* y);
+static bool quadConvex(const int* x, const int* y) {
+	//every corner turns the same way (or goes straight), so the quad can't fold over itself
+	int sign = 0;
+	for(int i=0; i<4; i++) {
+		int j = (i+1)%4;
+		int k = (i+2)%4;
+		long long cross = (long long)(x[j] - x[i])*(y[k] - y[j]) - (long long)(y[j] - y[i])*(x[k] - x[j]);
+		if(cross == 0) continue;
+		int turn = (cross > 0) ? 1 : -1;
+		if(sign != 0 && turn != sign) return false;
+		sign = turn;
+	}
+	return true;
+}
+static void edgeSetupSmooth(ScanEdge& edge, int topX, int topY, Color topColor, int bottomX, int bottomY, Color bottomColor, bool smooth, int y);
+static int lineMinorSteps(int ax, int ay, int error, int step);
+static void lineClip(int minor0, int minorSign, int minorSize, int ax, int ay, int error, int& first, int& last);
+static long long floorDiv(long long a, long long b);
+static unsigned int packPixel(unsigned char red, unsigned char green, unsigned char blue);
+static void fillPixels(unsigned char* pixel, unsigned int value, int count);
+static void copyPixels(unsigned char* destination, const unsigned char* source, int count);
+static void downsample(const unsigned char* source, int pitch, unsigned char* out, int count, int factor);
+template<int FACTOR> static void downsampleRow(const unsigned char* source, int pitch, unsigned char* out, int count, int factor);
+#if defined(VIDEO_SIMD_NEON) || defined(VIDEO_SIMD_SSE2)
+template<> void downsampleRow<2>(const unsigned char* source, int pitch, unsigned char* out, int count, int factor);
+template<> void downsampleRow<4>(const unsigned char* source, int pitch, unsigned char* out, int count, int factor);
+#endif
 
 //! Main constructor
 CVideoDriver::CVideoDriver(Vector size, unsigned int oversample, unsigned int rotation)
@@ -16,28 +83,66 @@ CVideoDriver::CVideoDriver(Vector size, unsigned int oversample, unsigned int ro
 	videoOversample = oversample;
 	videoSize = Vector(size.X, size.Y);
 	
+	//one display map entry per display pixel and one state per tile (both filled in by calcRotation)
+	displayMap = new int[size.X*size.Y];
+	tileState = new unsigned char[((size.X + VIDEO_DIRTY_TILE-1)/VIDEO_DIRTY_TILE)*((size.Y + VIDEO_DIRTY_TILE-1)/VIDEO_DIRTY_TILE)];
+	
 	videoBaseRotation = ((rotation%360)/90) * 90;
 	calcRotation(rotation);
 	
-	videoBuffer = new unsigned char[videoDimension.X*videoDimension.Y*3];
-	clearVideoBuffer(Color(0,0,0));
+	//rows of 32 bit pixels start on VIDEO_ROW_ALIGN boundaries (sized for either orientation)
+	int pitchX = ((size.X*oversample*4 + VIDEO_ROW_ALIGN-1)/VIDEO_ROW_ALIGN)*VIDEO_ROW_ALIGN;
+	int pitchY = ((size.Y*oversample*4 + VIDEO_ROW_ALIGN-1)/VIDEO_ROW_ALIGN)*VIDEO_ROW_ALIGN;
+	videoBufferSize = (pitchX*size.Y*oversample > pitchY*size.X*oversample) ? pitchX*size.Y*oversample : pitchY*size.X*oversample;
+	videoMemory = new unsigned char[videoBufferSize + VIDEO_ROW_ALIGN];
+	videoBuffer = videoMemory + (VIDEO_ROW_ALIGN - ((unsigned long)videoMemory % VIDEO_ROW_ALIGN)) % VIDEO_ROW_ALIGN;
+	displayBuffer = new unsigned char[size.X*size.Y*3 + ((size.X > size.Y) ? size.X : size.Y)*3]();
+	
+	//start out cleared (every tile is still sent to the display twice)
+	clearValue = packPixel(0, 0, 0);
+	fillPixels(videoBuffer, clearValue, videoBufferSize/4);
+	for(int i=0; i<tileCount.X*tileCount.Y; i++) tileState[i] = TILE_DRAWN | TILE_PUSH | TILE_PUSH_NEXT;
+	changedFraction = 1.0f;
 }
 
 //! Destructor
 CVideoDriver::~CVideoDriver()
 {
-	delete[] videoBuffer;
+	delete[] videoMemory;
+	delete[] displayBuffer;
+	delete[] displayMap;
+	delete[] tileState;
+	videoMemory = 0;
 	videoBuffer = 0;
+	displayBuffer = 0;
+	displayMap = 0;
+	tileState = 0;
 }
 
 //! Clears the video buffer to the specified color
 void CVideoDriver::clearVideoBuffer(Color color)
 {
-	for(int i=0; i<videoDimension.X*videoDimension.Y; i++) {
-		int index = i*3;
-		videoBuffer[index+0] = color.Red;
-		videoBuffer[index+1] = color.Green;
-		videoBuffer[index+2] = color.Blue;
+	unsigned int value = packPixel(color.Red, color.Green, color.Blue);
+	if(value != clearValue) {
+		fillPixels(videoBuffer, value, videoBufferSize/4);
+		clearValue = value;
+		for(int i=0; i<tileCount.X*tileCount.Y; i++) tileState[i] = (tileState[i] & ~TILE_COVERED) | TILE_DRAWN;
+		return;
+	}
+	
+	//only runs of tiles drawn on since the last clear hold anything but the clear color
+	int tilePixels = VIDEO_DIRTY_TILE*videoOversample;
+	for(int ty=0; ty<tileCount.Y; ty++) {
+		unsigned char* state = tileState + ty*tileCount.X;
+		for(int tx=0; tx<tileCount.X; tx++) {
+			if(!(state[tx] & TILE_COVERED)) continue;
+			int start = tx;
+			for(; tx<tileCount.X && (state[tx] & TILE_COVERED); tx++) state[tx] = (state[tx] & ~TILE_COVERED) | TILE_DRAWN;
+			int x0 = start*tilePixels;
+			int x1 = (tx*tilePixels > videoDimension.X) ? videoDimension.X : tx*tilePixels;
+			int y1 = ((ty+1)*tilePixels > videoDimension.Y) ? videoDimension.Y : (ty+1)*tilePixels;
+			for(int y=ty*tilePixels; y<y1; y++) fillPixels(videoBuffer + y*videoPitch + x0*4, value, x1 - x0);
+		}
 	}
 }
 
@@ -78,65 +183,505 @@ unsigned int CVideoDriver::getOversample() const
 	return videoOversample;
 }
 
+//! Gets the fraction of the display area that changed in the last flush (0-1)
+float CVideoDriver::getChangedFraction() const
+{
+	return changedFraction;
+}
+
 //! Draws a point
 void CVideoDriver::drawPoint(Vector pos, Color color)
 {
 	if(pos.X >= 0 && pos.X < videoDimension.X && pos.Y >= 0 && pos.Y < videoDimension.Y) {
-		int index = (pos.Y*videoDimension.X + pos.X)*3;
-		videoBuffer[index+0] = color.Red;
-		videoBuffer[index+1] = color.Green;
-		videoBuffer[index+2] = color.Blue;
+		unsigned int value = packPixel(color.Red, color.Green, color.Blue);
+		memcpy(videoBuffer + pos.Y*videoPitch + pos.X*4, &value, 4);
+		markDirty(pos.X, pos.Y, pos.X, pos.Y);
 	}
 }
 
 //! Draws a line
 void CVideoDriver::drawLine(Vector pos0, Color color0, Vector pos1, Color color1)
 {
-    drawLine_mem(pos0, color0, pos1, color1, 0, 0);
+	//bresenham along the major axis (x on ties)
+	int dx = pos1.X - pos0.X;
+	int dy = pos1.Y - pos0.Y;
+	bool steep = ABS(dy) > ABS(dx);
+	int major0 = steep ? pos0.Y : pos0.X;
+	int minor0 = steep ? pos0.X : pos0.Y;
+	int majorSign = ZSGN(steep ? dy : dx);
+	int minorSign = ZSGN(steep ? dx : dy);
+	int majorSize = steep ? videoDimension.Y : videoDimension.X;
+	int minorSize = steep ? videoDimension.X : videoDimension.Y;
+	int steps = ABS(steep ? dy : dx);
+	int ax = steps << 1;
+	int ay = ABS(steep ? dx : dy) << 1;
+	int error = ay - (ax >> 1);
+	
+	//clip the range of steps against the viewport once (the visible pixels match the unclipped line)
+	int first = 0;
+	int last = steps;
+	if(majorSign > 0) {
+		if(-major0 > first) first = -major0;
+		if((majorSize-1) - major0 < last) last = (majorSize-1) - major0;
+	} else if(majorSign < 0) {
+		if(major0 - (majorSize-1) > first) first = major0 - (majorSize-1);
+		if(major0 < last) last = major0;
+	} else if(major0 < 0 || major0 >= majorSize) {
+		return;
+	}
+	lineClip(minor0, minorSign, minorSize, ax, ay, error, first, last);
+	if(first > last) return;
+	markDirty((pos0.X < pos1.X) ? pos0.X : pos1.X, (pos0.Y < pos1.Y) ? pos0.Y : pos1.Y, (pos0.X > pos1.X) ? pos0.X : pos1.X, (pos0.Y > pos1.Y) ? pos0.Y : pos1.Y);
+	
+	//jump the bresenham state to the first visible step
+	int minorSteps = (first > 0) ? lineMinorSteps(ax, ay, error, first) : 0;
+	int minor = minor0 + minorSign*minorSteps;
+	int major = major0 + majorSign*first;
+	error += first*ay - minorSteps*ax;
+	
+	//walk the buffer directly (no per pixel checks)
+	int index = steep ? (major*videoPitch + minor*4) : (minor*videoPitch + major*4);
+	int majorStride = majorSign*(steep ? videoPitch : 4);
+	int minorStride = minorSign*(steep ? 4 : videoPitch);
+	int count = last - first;
+	if(color0 == color1) {
+		unsigned int value = packPixel(color0.Red, color0.Green, color0.Blue);
+		for(int k=0; k<=count; k++) {
+			memcpy(videoBuffer + index, &value, 4);
+			if(error >= 0) {
+				index += minorStride;
+				error -= ax;
+			}
+			index += majorStride;
+			error += ay;
+		}
+	} else {
+		//16.16 color stepping from color0 at the first end to color1 at the last
+		int length = (steps > 0) ? steps : 1;
+		int stepRed = (((int)color1.Red - (int)color0.Red) << FIXED_SHIFT)/length;
+		int stepGreen = (((int)color1.Green - (int)color0.Green) << FIXED_SHIFT)/length;
+		int stepBlue = (((int)color1.Blue - (int)color0.Blue) << FIXED_SHIFT)/length;
+		int red = (color0.Red << FIXED_SHIFT) + FIXED_HALF + stepRed*first;
+		int green = (color0.Green << FIXED_SHIFT) + FIXED_HALF + stepGreen*first;
+		int blue = (color0.Blue << FIXED_SHIFT) + FIXED_HALF + stepBlue*first;
+		for(int k=0; k<=count; k++) {
+			unsigned int value = packPixel(red >> FIXED_SHIFT, green >> FIXED_SHIFT, blue >> FIXED_SHIFT);
+			memcpy(videoBuffer + index, &value, 4);
+			if(error >= 0) {
+				index += minorStride;
+				error -= ax;
+			}
+			index += majorStride;
+			error += ay;
+			red += stepRed;
+			green += stepGreen;
+			blue += stepBlue;
+		}
+	}
 }
 
 //! Draws a triangle
 void CVideoDriver::drawTri(Vector pos0, Color color0, Vector pos1, Color color1, Vector pos2, Color color2)
 {
-	//setup outline buffer
-	int memMinMax[videoDimension.Y][2];
-	Color memMinMaxColor[videoDimension.Y][2];
-	for(int y=0; y<videoDimension.Y; y++) {
-		memMinMax[y][0] = INT_MAX;
-		memMinMax[y][1] = INT_MIN;
+	//sort the vertices top to bottom
+	Vector pos[3] = {pos0, pos1, pos2};
+	Color color[3] = {color0, color1, color2};
+	for(int i=0; i<2; i++) {
+		for(int j=0; j<2-i; j++) {
+			if(pos[j+1].Y < pos[j].Y) {
+				Vector p = pos[j]; pos[j] = pos[j+1]; pos[j+1] = p;
+				Color c = color[j]; color[j] = color[j+1]; color[j+1] = c;
+			}
+		}
 	}
 	
-	//draw outline
-	drawLine_mem(pos0, color0, pos1, color1, memMinMax, memMinMaxColor);
-	drawLine_mem(pos1, color1, pos2, color2, memMinMax, memMinMaxColor);
-	drawLine_mem(pos2, color2, pos0, color0, memMinMax, memMinMaxColor);
+	//only walk the rows the triangle touches
+	int yStart = (pos[0].Y < 0) ? 0 : pos[0].Y;
+	int yEnd = (pos[2].Y > videoDimension.Y-1) ? videoDimension.Y-1 : pos[2].Y;
+	if(yStart > yEnd) return;
+	ScanEdge edges[3];
+	edgeSetup(edges[0], pos[0], color[0], pos[2], color[2], yStart);
+	edgeSetup(edges[1], pos[0], color[0], pos[1], color[1], yStart);
+	edgeSetup(edges[2], pos[1], color[1], pos[2], color[2], yStart);
+	bool flat = (color[0] == color[1] && color[1] == color[2]);
 	
-	//fill in the triangle
-	for(int y=0; y<videoDimension.Y; y++) {
-		if(memMinMax[y][0] < INT_MAX && memMinMax[y][1] > INT_MIN) {
-			Color color0 = memMinMaxColor[y][0];
-			Color color1 = memMinMaxColor[y][1];
-			
-			int dist = memMinMax[y][1]-memMinMax[y][0];
-			for(int x=1; x<dist; x++) {
-				Color color = color0;
-				color.lerp(color1, (x*100)/dist);
-				drawPoint(Vector(memMinMax[y][0]+x, y), color);
+	//fill each row between the outermost edge pixels (edges covered like a line would draw them)
+	int dirtyLeft = INT_MAX;
+	int dirtyRight = INT_MIN;
+	for(int y=yStart; y<=yEnd; y++) {
+		int left = INT_MAX;
+		int right = INT_MIN;
+		Color leftColor, rightColor;
+		for(int e=0; e<3; e++) edgeCover(edges[e], y, left, right, leftColor, rightColor);
+		if(left > right) continue;
+		if(flat) fillSpan(y, left, right, color[0]);
+		else fillSpanGradient(y, left, right, leftColor, rightColor);
+		if(left < dirtyLeft) dirtyLeft = left;
+		if(right > dirtyRight) dirtyRight = right;
+	}
+	markDirty(dirtyLeft, yStart, dirtyRight, yEnd);
+}
+
+//! Draws a convex quad (edges covered like drawTri, so thin quads keep their pixels and neighbours overlap on shared edges)
+void CVideoDriver::drawQuad(Vector pos0, Color color0, Vector pos1, Color color1, Vector pos2, Color color2, Vector pos3, Color color3)
+{
+	Vector pos[4] = {pos0, pos1, pos2, pos3};
+	Color color[4] = {color0, color1, color2, color3};
+	fillPolygonCovered(pos, color, 4);
+}
+
+//! Draws a convex polygon of up to VIDEO_MAX_POLYGON_VERTICES (edges shared with a neighbouring polygon are only drawn once)
+void CVideoDriver::drawPolygon(const Vector* pos, const Color* color, int n)
+{
+	if(n < 3) return;
+	if(n > VIDEO_MAX_POLYGON_VERTICES) n = VIDEO_MAX_POLYGON_VERTICES;
+	
+	//only walk the rows the polygon owns
+	int yMin = pos[0].Y;
+	int yMax = pos[0].Y;
+	bool flat = true;
+	for(int i=1; i<n; i++) {
+		if(pos[i].Y < yMin) yMin = pos[i].Y;
+		if(pos[i].Y > yMax) yMax = pos[i].Y;
+		if(color[i] != color[0]) flat = false;
+	}
+	int yStart = (yMin < 0) ? 0 : yMin;
+	int yEnd = (yMax > videoDimension.Y) ? videoDimension.Y : yMax;
+	if(yStart >= yEnd) return;
+	
+	//edges top to bottom (each edge owns its top row but not its bottom one, flat edges own none)
+	ScanEdge edges[VIDEO_MAX_POLYGON_VERTICES];
+	int numEdges = 0;
+	for(int i=0; i<n; i++) {
+		int j = (i+1)%n;
+		if(pos[i].Y < pos[j].Y) edgeSetup(edges[numEdges++], pos[i], color[i], pos[j], color[j], yStart);
+		else if(pos[i].Y > pos[j].Y) edgeSetup(edges[numEdges++], pos[j], color[j], pos[i], color[i], yStart);
+	}
+	
+	//fill the pixel centers from the left edge up to (not including) the right edge
+	int dirtyLeft = INT_MAX;
+	int dirtyRight = INT_MIN;
+	for(int y=yStart; y<yEnd; y++) {
+		int left = INT_MAX;
+		int right = INT_MIN;
+		Color leftColor, rightColor;
+		for(int e=0; e<numEdges; e++) {
+			ScanEdge& edge = edges[e];
+			if(y >= edge.yTop && y < edge.yBottom) {
+				if(edge.x < left) {
+					left = edge.x;
+					if(!flat) leftColor = edgeColor(edge);
+				}
+				if(edge.x > right) {
+					right = edge.x;
+					if(!flat) rightColor = edgeColor(edge);
+				}
 			}
+			if(flat) edge.x += edge.step;
+			else edgeStep(edge);
 		}
+		int x0 = (left + FIXED_ONE - 1) >> FIXED_SHIFT;
+		int x1 = ((right + FIXED_ONE - 1) >> FIXED_SHIFT) - 1;
+		if(x0 > x1) continue;
+		if(flat) fillSpan(y, x0, x1, color[0]);
+		else fillSpanGradient(y, x0, x1, leftColor, rightColor);
+		if(x0 < dirtyLeft) dirtyLeft = x0;
+		if(x1 > dirtyRight) dirtyRight = x1;
 	}
+	markDirty(dirtyLeft, yStart, dirtyRight, yEnd-1);
 }
 
-//! Draws a quad
-void CVideoDriver::drawQuad(Vector pos0, Color color0, Vector pos1, Color color1, Vector pos2, Color color2, Vector pos3, Color color3)
+//! Draws connected lines through the points as one stroke width pixels wide (joints share their vertices, past VIDEO_MITER_LIMIT they are beveled)
+void CVideoDriver::drawPolyline(const Vector* points, int count, int width, Color color)
+{
+	if(count < 2 || width < 1) return;
+	
+	//each segment is a quad between the offset vertices of its two points (joints use the normals of both segments)
+	float halfWidth = width*0.5f;
+	float normal0[2] = {0, 0}, normal1[2], offset[2];
+	Vector pos[4];
+	Color colors[4] = {color, color, color, color};
+	for(int i=1; i<count && normal0[0] == 0 && normal0[1] == 0; i++) segmentNormal(points[i-1], points[i], normal0);
+	for(int i=0; i<count; i++) {
+		normal1[0] = normal0[0];
+		normal1[1] = normal0[1];
+		if(i > 0 && i < count-1) segmentNormal(points[i], points[i+1], normal1);
+		
+		//the segment ending here takes the miter vertices (or ends square when the joint is too sharp and gets beveled)
+		bool miter = strokeJoint(normal0, normal1, halfWidth, offset);
+		float endX = miter ? offset[0] : normal0[0]*halfWidth;
+		float endY = miter ? offset[1] : normal0[1]*halfWidth;
+		pos[1] = Vector((int)floorf(points[i].X + endX + 0.5f), (int)floorf(points[i].Y + endY + 0.5f));
+		pos[2] = Vector((int)floorf(points[i].X - endX + 0.5f), (int)floorf(points[i].Y - endY + 0.5f));
+		if(i > 0) {
+			int x[4] = {pos[0].X, pos[1].X, pos[2].X, pos[3].X};
+			int y[4] = {pos[0].Y, pos[1].Y, pos[2].Y, pos[3].Y};
+			if(quadConvex(x, y)) {
+				drawPolygon(pos, colors, 4);
+			} else {
+				//a miter longer than the segment folded the quad over itself, so draw the segment square and fill out to the joint vertices
+				float sideX = normal0[0]*halfWidth;
+				float sideY = normal0[1]*halfWidth;
+				Vector side[4];
+				side[0] = Vector((int)floorf(points[i-1].X + sideX + 0.5f), (int)floorf(points[i-1].Y + sideY + 0.5f));
+				side[1] = Vector((int)floorf(points[i].X + sideX + 0.5f), (int)floorf(points[i].Y + sideY + 0.5f));
+				side[2] = Vector((int)floorf(points[i].X - sideX + 0.5f), (int)floorf(points[i].Y - sideY + 0.5f));
+				side[3] = Vector((int)floorf(points[i-1].X - sideX + 0.5f), (int)floorf(points[i-1].Y - sideY + 0.5f));
+				drawPolygon(side, colors, 4);
+				for(int k=0; k<4; k++) {
+					Vector fill[3] = {(k == 0 || k == 3) ? points[i-1] : points[i], side[k], pos[k]};
+					drawPolygon(fill, colors, 3);
+				}
+			}
+		}
+		
+		//the next segment starts from the same vertices, or square with a bevel triangle on each side
+		pos[0] = pos[1];
+		pos[3] = pos[2];
+		if(!miter) {
+			pos[0] = Vector((int)floorf(points[i].X + normal1[0]*halfWidth + 0.5f), (int)floorf(points[i].Y + normal1[1]*halfWidth + 0.5f));
+			pos[3] = Vector((int)floorf(points[i].X - normal1[0]*halfWidth + 0.5f), (int)floorf(points[i].Y - normal1[1]*halfWidth + 0.5f));
+			Vector bevel0[3] = {points[i], pos[1], pos[0]};
+			Vector bevel1[3] = {points[i], pos[2], pos[3]};
+			drawPolygon(bevel0, colors, 3);
+			drawPolygon(bevel1, colors, 3);
+		}
+		normal0[0] = normal1[0];
+		normal0[1] = normal1[1];
+	}
+}
+
+//! Draws connected lines through the points with an outline outlineWidth pixels wide on both sides
+void CVideoDriver::drawPolylineOutlined(const Vector* points, int count, int width, Color color, int outlineWidth, Color outlineColor)
+{
+	drawPolyline(points, count, width + outlineWidth*2, outlineColor);
+	drawPolyline(points, count, width, color);
+}
+
+//! Blends a point over the video buffer (alpha 0-255)
+void CVideoDriver::blendPoint(Vector pos, Color color, unsigned char alpha)
+{
+	blendPixel(pos.X, pos.Y, color, alpha + (alpha >> 7));
+	markDirty(pos.X, pos.Y, pos.X, pos.Y);
+}
+
+//! Draws an anti-aliased line (each step is split between the two pixels the line passes between)
+void CVideoDriver::drawLineAA(Vector pos0, Color color0, Vector pos1, Color color1)
+{
+	//walk the major axis from the lower end
+	bool steep = ABS(pos1.Y - pos0.Y) > ABS(pos1.X - pos0.X);
+	int major0 = steep ? pos0.Y : pos0.X;
+	int major1 = steep ? pos1.Y : pos1.X;
+	int minor0 = steep ? pos0.X : pos0.Y;
+	int minor1 = steep ? pos1.X : pos1.Y;
+	if(major0 > major1) {
+		int t = major0; major0 = major1; major1 = t;
+		t = minor0; minor0 = minor1; minor1 = t;
+		Color c = color0; color0 = color1; color1 = c;
+	}
+	if(steep) markDirty((minor0 < minor1) ? minor0 : minor1, major0, ((minor0 > minor1) ? minor0 : minor1) + 1, major1);
+	else markDirty(major0, (minor0 < minor1) ? minor0 : minor1, major1, ((minor0 > minor1) ? minor0 : minor1) + 1);
+	
+	//16.16 minor position and color stepping
+	int length = (major1 > major0) ? (major1 - major0) : 1;
+	int minorStep = ((minor1 - minor0) << FIXED_SHIFT)/length;
+	int stepRed = (((int)color1.Red - (int)color0.Red) << FIXED_SHIFT)/length;
+	int stepGreen = (((int)color1.Green - (int)color0.Green) << FIXED_SHIFT)/length;
+	int stepBlue = (((int)color1.Blue - (int)color0.Blue) << FIXED_SHIFT)/length;
+	
+	//the pixel the minor position is in and the one after it are walked separately, each clipped to the viewport once
+	int majorSize = steep ? videoDimension.Y : videoDimension.X;
+	int minorSize = steep ? videoDimension.X : videoDimension.Y;
+	int majorStride = steep ? videoPitch : 4;
+	int minorStride = steep ? 4 : videoPitch;
+	for(int side=0; side<2; side++) {
+		//steps along the major axis inside the viewport whose pixel on this side is too
+		long long first = (major0 < 0) ? -major0 : 0;
+		long long last = ((major1 > majorSize-1) ? majorSize-1 : major1) - major0;
+		long long low = (long long)(0 - side - minor0)*FIXED_ONE;
+		long long high = (long long)((minorSize-1) - side - minor0)*FIXED_ONE + (FIXED_ONE-1);
+		if(minorStep != 0) {
+			long long lowStep = (minorStep > 0) ? -floorDiv(-low, minorStep) : floorDiv(low, minorStep);
+			long long highStep = (minorStep > 0) ? floorDiv(high, minorStep) : -floorDiv(-high, minorStep);
+			if(minorStep > 0) {
+				if(lowStep > first) first = lowStep;
+				if(highStep < last) last = highStep;
+			} else {
+				if(highStep > first) first = highStep;
+				if(lowStep < last) last = lowStep;
+			}
+		} else if(low > 0 || high < 0) {
+			continue;
+		}
+		if(first > last) continue;
+		
+		int minor = (minor0 << FIXED_SHIFT) + (int)first*minorStep;
+		int red = (color0.Red << FIXED_SHIFT) + FIXED_HALF + (int)first*stepRed;
+		int green = (color0.Green << FIXED_SHIFT) + FIXED_HALF + (int)first*stepGreen;
+		int blue = (color0.Blue << FIXED_SHIFT) + FIXED_HALF + (int)first*stepBlue;
+		unsigned char* pixel = videoBuffer + (major0 + (int)first)*majorStride;
+		for(int k=(int)first; k<=(int)last; k++, pixel+=majorStride) {
+			int fraction = (minor & (FIXED_ONE-1)) >> (FIXED_SHIFT-8);
+			int alpha = side ? fraction : 256 - fraction;
+			unsigned char* target = pixel + ((minor >> FIXED_SHIFT) + side)*minorStride;
+			target[0] += (((red >> FIXED_SHIFT) - (int)target[0])*alpha) >> 8;
+			target[1] += (((green >> FIXED_SHIFT) - (int)target[1])*alpha) >> 8;
+			target[2] += (((blue >> FIXED_SHIFT) - (int)target[2])*alpha) >> 8;
+			minor += minorStep;
+			red += stepRed;
+			green += stepGreen;
+			blue += stepBlue;
+		}
+	}
+}
+
+//! Draws a convex polygon with anti-aliased edges (coverage blended over the buffer, vertices on pixel corners like drawPolygon, bit i of smoothEdges smooths the edge from vertex i)
+void CVideoDriver::drawPolygonAA(const Vector* pos, const Color* color, int n, unsigned int smoothEdges)
+{
+	if(n > VIDEO_MAX_POLYGON_VERTICES) n = VIDEO_MAX_POLYGON_VERTICES;
+	int x[VIDEO_MAX_POLYGON_VERTICES];
+	int y[VIDEO_MAX_POLYGON_VERTICES];
+	for(int i=0; i<n; i++) {
+		x[i] = pos[i].X << FIXED_SHIFT;
+		y[i] = pos[i].Y << FIXED_SHIFT;
+	}
+	fillPolygonSmooth(x, y, color, n, smoothEdges);
+}
+
+//! Draws connected lines through the points as one stroke width pixels wide with anti-aliased sides and ends
+void CVideoDriver::drawPolylineAA(const Vector* points, int count, int width, Color color)
+{
+	if(count < 2 || width < 1) return;
+	
+	//same quads as drawPolyline but with sub pixel vertices (joints stay hard so the segments meet without seams)
+	float halfWidth = width*0.5f;
+	float normal0[2] = {0, 0}, normal1[2], offset[2];
+	int x[4], y[4];
+	Color colors[4] = {color, color, color, color};
+	for(int i=1; i<count && normal0[0] == 0 && normal0[1] == 0; i++) segmentNormal(points[i-1], points[i], normal0);
+	for(int i=0; i<count; i++) {
+		normal1[0] = normal0[0];
+		normal1[1] = normal0[1];
+		if(i > 0 && i < count-1) segmentNormal(points[i], points[i+1], normal1);
+		bool miter = strokeJoint(normal0, normal1, halfWidth, offset);
+		float endX = miter ? offset[0] : normal0[0]*halfWidth;
+		float endY = miter ? offset[1] : normal0[1]*halfWidth;
+		x[1] = (int)floorf((points[i].X + endX)*FIXED_ONE + 0.5f);
+		y[1] = (int)floorf((points[i].Y + endY)*FIXED_ONE + 0.5f);
+		x[2] = (int)floorf((points[i].X - endX)*FIXED_ONE + 0.5f);
+		y[2] = (int)floorf((points[i].Y - endY)*FIXED_ONE + 0.5f);
+		if(i > 0) {
+			unsigned int smoothEdges = (1 << 0) | (1 << 2);
+			if(i == 1) smoothEdges |= (1 << 3);
+			if(i == count-1) smoothEdges |= (1 << 1);
+			if(quadConvex(x, y)) {
+				fillPolygonSmooth(x, y, colors, 4, smoothEdges);
+			} else {
+				//a miter longer than the segment folded the quad over itself, so draw the segment square and fill out to the joint vertices
+				float sideX = normal0[0]*halfWidth;
+				float sideY = normal0[1]*halfWidth;
+				int sx[4], sy[4];
+				sx[0] = (int)floorf((points[i-1].X + sideX)*FIXED_ONE + 0.5f);
+				sy[0] = (int)floorf((points[i-1].Y + sideY)*FIXED_ONE + 0.5f);
+				sx[1] = (int)floorf((points[i].X + sideX)*FIXED_ONE + 0.5f);
+				sy[1] = (int)floorf((points[i].Y + sideY)*FIXED_ONE + 0.5f);
+				sx[2] = (int)floorf((points[i].X - sideX)*FIXED_ONE + 0.5f);
+				sy[2] = (int)floorf((points[i].Y - sideY)*FIXED_ONE + 0.5f);
+				sx[3] = (int)floorf((points[i-1].X - sideX)*FIXED_ONE + 0.5f);
+				sy[3] = (int)floorf((points[i-1].Y - sideY)*FIXED_ONE + 0.5f);
+				fillPolygonSmooth(sx, sy, colors, 4, smoothEdges);
+				for(int k=0; k<4; k++) {
+					Vector joint = (k == 0 || k == 3) ? points[i-1] : points[i];
+					int fx[3] = {joint.X << FIXED_SHIFT, sx[k], x[k]};
+					int fy[3] = {joint.Y << FIXED_SHIFT, sy[k], y[k]};
+					fillPolygonSmooth(fx, fy, colors, 3, 1 << 1);
+				}
+			}
+		}
+		x[0] = x[1];
+		y[0] = y[1];
+		x[3] = x[2];
+		y[3] = y[2];
+		if(!miter) {
+			x[0] = (int)floorf((points[i].X + normal1[0]*halfWidth)*FIXED_ONE + 0.5f);
+			y[0] = (int)floorf((points[i].Y + normal1[1]*halfWidth)*FIXED_ONE + 0.5f);
+			x[3] = (int)floorf((points[i].X - normal1[0]*halfWidth)*FIXED_ONE + 0.5f);
+			y[3] = (int)floorf((points[i].Y - normal1[1]*halfWidth)*FIXED_ONE + 0.5f);
+			int bx0[3] = {points[i].X << FIXED_SHIFT, x[1], x[0]};
+			int by0[3] = {points[i].Y << FIXED_SHIFT, y[1], y[0]};
+			int bx1[3] = {points[i].X << FIXED_SHIFT, x[2], x[3]};
+			int by1[3] = {points[i].Y << FIXED_SHIFT, y[2], y[3]};
+			fillPolygonSmooth(bx0, by0, colors, 3, 1 << 1);
+			fillPolygonSmooth(bx1, by1, colors, 3, 1 << 1);
+		}
+		normal0[0] = normal1[0];
+		normal0[1] = normal1[1];
+	}
+}
+
+//! Draws an anti-aliased stroke with an outline outlineWidth pixels wide on both sides
+void CVideoDriver::drawPolylineOutlinedAA(const Vector* points, int count, int width, Color color, int outlineWidth, Color outlineColor)
 {
-	Vector posC = (pos0 + pos1 + pos2 + pos3)/4;
-	Color colorC = (color0/4) + (color1/4) + (color2/4) + (color3/4);
+	drawPolylineAA(points, count, width + outlineWidth*2, outlineColor);
+	drawPolylineAA(points, count, width, color);
+}
+
+//! Fills a rectangle with one color (clipped to the buffer)
+void CVideoDriver::fillRect(Vector pos, Vector size, Color color)
+{
+	int x0 = (pos.X < 0) ? 0 : pos.X;
+	int y0 = (pos.Y < 0) ? 0 : pos.Y;
+	int x1 = (pos.X + size.X > videoDimension.X) ? videoDimension.X : pos.X + size.X;
+	int y1 = (pos.Y + size.Y > videoDimension.Y) ? videoDimension.Y : pos.Y + size.Y;
+	if(x0 >= x1 || y0 >= y1) return;
+	
+	unsigned int value = packPixel(color.Red, color.Green, color.Blue);
+	for(int y=y0; y<y1; y++) fillPixels(videoBuffer + y*videoPitch + x0*4, value, x1 - x0);
+	markDirty(x0, y0, x1-1, y1-1);
+}
+
+//! Copies a rectangle of the video buffer to another position (clipped to the buffer, the two may overlap)
+void CVideoDriver::copyRect(Vector from, Vector size, Vector to)
+{
+	//clip against both the source and the destination
+	if(from.X < 0) { to.X -= from.X; size.X += from.X; from.X = 0; }
+	if(from.Y < 0) { to.Y -= from.Y; size.Y += from.Y; from.Y = 0; }
+	if(to.X < 0) { from.X -= to.X; size.X += to.X; to.X = 0; }
+	if(to.Y < 0) { from.Y -= to.Y; size.Y += to.Y; to.Y = 0; }
+	if(from.X + size.X > videoDimension.X) size.X = videoDimension.X - from.X;
+	if(from.Y + size.Y > videoDimension.Y) size.Y = videoDimension.Y - from.Y;
+	if(to.X + size.X > videoDimension.X) size.X = videoDimension.X - to.X;
+	if(to.Y + size.Y > videoDimension.Y) size.Y = videoDimension.Y - to.Y;
+	if(size.X <= 0 || size.Y <= 0) return;
 	
-	drawTri(pos0, color0, posC, colorC, pos1, color1);
-	drawTri(pos1, color1, posC, colorC, pos2, color2);
-	drawTri(pos2, color2, posC, colorC, pos3, color3);
-	drawTri(pos3, color3, posC, colorC, pos0, color0);
+	//copy rows bottom up when moving down so overlapping rows are read before they are written
+	for(int i=0; i<size.Y; i++) {
+		int row = (to.Y > from.Y) ? (size.Y-1) - i : i;
+		copyPixels(videoBuffer + (to.Y + row)*videoPitch + to.X*4, videoBuffer + (from.Y + row)*videoPitch + from.X*4, size.X);
+	}
+	markDirty(to.X, to.Y, to.X + size.X-1, to.Y + size.Y-1);
+}
+
+//! Copies the video buffer out as RGB888 (3 bytes per pixel, rows stride bytes apart)
+void CVideoDriver::copyToRGB(unsigned char* rgb, int stride) const
+{
+	for(int y=0; y<videoDimension.Y; y++) {
+		const unsigned char* pixel = videoBuffer + y*videoPitch;
+		unsigned char* out = rgb + y*stride;
+		int x = 0;
+#if defined(VIDEO_SIMD_NEON)
+		for(; x+16<=videoDimension.X; x+=16) {
+			uint8x16x4_t rgbx = vld4q_u8(pixel + x*4);
+			uint8x16x3_t packed = {{rgbx.val[0], rgbx.val[1], rgbx.val[2]}};
+			vst3q_u8(out + x*3, packed);
+		}
+#endif
+		for(; x<videoDimension.X; x++) {
+			out[x*3 + 0] = pixel[x*4 + 0];
+			out[x*3 + 1] = pixel[x*4 + 1];
+			out[x*3 + 2] = pixel[x*4 + 2];
+		}
+	}
 }
 
 //! Sends the video data to the display
@@ -144,32 +689,49 @@ void CVideoDriver::flush()
 {
 	int displayX = videoDimension.X/videoOversample;
 	int displayY = videoDimension.Y/videoOversample;
-	for(int x=0; x<displayX; x++) {
-		for(int y=0; y<displayY; y++) {
-			int red = 0;
-			int green = 0;
-			int blue = 0;
-			for(int xp=0; xp<videoOversample; xp++) {
-				for(int yp=0; yp<videoOversample; yp++) {
-					int vbIndex = ((y*videoOversample + yp)*videoDimension.X + (x*videoOversample + xp))*3;
-					red += videoBuffer[vbIndex+0];
-					green += videoBuffer[vbIndex+1];
-					blue += videoBuffer[vbIndex+2];
+	
+	//average the blocks under each run of tiles drawn on (or still owed to the display) one row at a time
+	int changedArea = 0;
+	unsigned char* row = displayBuffer + videoSize.X*videoSize.Y*3;
+	for(int ty=0; ty<tileCount.Y; ty++) {
+		unsigned char* state = tileState + ty*tileCount.X;
+		int y0 = ty*VIDEO_DIRTY_TILE;
+		int y1 = (y0 + VIDEO_DIRTY_TILE > displayY) ? displayY : y0 + VIDEO_DIRTY_TILE;
+		for(int tx=0; tx<tileCount.X; tx++) {
+			if(!(state[tx] & (TILE_DRAWN | TILE_PUSH))) continue;
+			int start = tx;
+			bool push = false;
+			for(; tx<tileCount.X && (state[tx] & (TILE_DRAWN | TILE_PUSH)); tx++) {
+				if(state[tx] & TILE_PUSH) push = true;
+			}
+			int x0 = start*VIDEO_DIRTY_TILE;
+			int x1 = (tx*VIDEO_DIRTY_TILE > displayX) ? displayX : tx*VIDEO_DIRTY_TILE;
+			for(int y=y0; y<y1; y++) {
+				downsample(videoBuffer + y*videoOversample*videoPitch + x0*videoOversample*4, videoPitch, row, x1 - x0, videoOversample);
+				
+				//the row is only sent when a tile in it differs from what the display already shows
+				unsigned char* out = displayBuffer + (y*displayX + x0)*3;
+				bool send = push;
+				for(int t=start; t<tx; t++) {
+					int offset = (t - start)*VIDEO_DIRTY_TILE*3;
+					int count = (t == tx-1) ? (x1 - x0) - (t - start)*VIDEO_DIRTY_TILE : VIDEO_DIRTY_TILE;
+					if(memcmp(row + offset, out + offset, count*3) == 0) continue;
+					memcpy(out + offset, row + offset, count*3);
+					changedArea += count;
+					state[t] |= TILE_CHANGED;
+					send = true;
 				}
+				if(send) led_writeIndexed(out, displayMap + y*displayX + x0, x1 - x0);
 			}
 			
-			red /= (videoOversample*videoOversample);
-			green /= (videoOversample*videoOversample);
-			blue /= (videoOversample*videoOversample);
-			
-			//determine how to draw by rotation calculations
-			int yr = y, xr = x;
-			if(videoMirror.Y > 0) yr = (displayY-1) - y;
-			if(videoMirror.X > 0) xr = (displayX-1) - x;
-			if(videoXYFlip > 0) led_write(yr, xr, red, green, blue);
-			else led_write(xr, yr, red, green, blue);
+			//the led layer may double buffer, so a change is sent again on the next flush
+			for(int t=start; t<tx; t++) {
+				unsigned char next = (state[t] & (TILE_CHANGED | TILE_PUSH_NEXT)) ? TILE_PUSH : 0;
+				state[t] = (state[t] & TILE_COVERED) | next;
+			}
 		}
 	}
+	changedFraction = (float)changedArea/(displayX*displayY);
 	
 	led_flush();
 }
@@ -178,8 +740,8 @@ void CVideoDriver::flush()
 Color CVideoDriver::getPoint(Vector pos)
 {
 	if(pos.X >= 0 && pos.X < videoDimension.X && pos.Y >= 0 && pos.Y < videoDimension.Y) {
-		int index = (pos.Y*videoDimension.X + pos.X)*3;
-		return Color(videoBuffer[index+0], videoBuffer[index+1], videoBuffer[index+2]);
+		const unsigned char* pixel = videoBuffer + pos.Y*videoPitch + pos.X*4;
+		return Color(pixel[0], pixel[1], pixel[2]);
 	}
 	return Color(0, 0, 0);
 }
@@ -195,6 +757,7 @@ void CVideoDriver::calcRotation(int angle)
 		videoDimension = Vector(videoSize.Y*videoOversample, videoSize.X*videoOversample);
 		videoXYFlip = 1;
 	}
+	videoPitch = ((videoDimension.X*4 + VIDEO_ROW_ALIGN-1)/VIDEO_ROW_ALIGN)*VIDEO_ROW_ALIGN;
 	if(angle == 90 || angle == 180) {
 		videoMirror.Y = 1;
 	} else {
@@ -205,79 +768,547 @@ void CVideoDriver::calcRotation(int angle)
 	} else {
 		videoMirror.X = 0;
 	}
+	calcDisplayMap();
+	
+	//the buffer reads differently now so every tile is redrawn and sent twice
+	tileCount = Vector((videoDimension.X/videoOversample + VIDEO_DIRTY_TILE-1)/VIDEO_DIRTY_TILE, (videoDimension.Y/videoOversample + VIDEO_DIRTY_TILE-1)/VIDEO_DIRTY_TILE);
+	for(int i=0; i<tileCount.X*tileCount.Y; i++) tileState[i] = TILE_DRAWN | TILE_COVERED | TILE_PUSH | TILE_PUSH_NEXT;
 }
 
-//! Draws a line and records the outline to memory
-void CVideoDriver::drawLine_mem(Vector pos0, Color color0, Vector pos1, Color color1, int mem[][2], Color memc[][2])
+//! Calculates the led position each display buffer pixel is shown at for the current rotation
+void CVideoDriver::calcDisplayMap()
 {
-    int dx = pos1.X - pos0.X;
-    int dy = pos1.Y - pos0.Y;
+	int displayX = videoDimension.X/videoOversample;
+	int displayY = videoDimension.Y/videoOversample;
+	for(int y=0; y<displayY; y++) {
+		for(int x=0; x<displayX; x++) {
+			int yr = y, xr = x;
+			if(videoMirror.Y > 0) yr = (displayY-1) - y;
+			if(videoMirror.X > 0) xr = (displayX-1) - x;
+			displayMap[y*displayX + x] = (videoXYFlip > 0) ? led_getIndex(yr, xr) : led_getIndex(xr, yr);
+		}
+	}
+}
 
-    int ax = ABS(dx) << 1;
-    int ay = ABS(dy) << 1;
+//! Marks the tiles a rectangle of the video buffer touches as drawn on (inclusive, clipped to the buffer)
+void CVideoDriver::markDirty(int x0, int y0, int x1, int y1)
+{
+	if(x0 < 0) x0 = 0;
+	if(y0 < 0) y0 = 0;
+	if(x1 > videoDimension.X-1) x1 = videoDimension.X-1;
+	if(y1 > videoDimension.Y-1) y1 = videoDimension.Y-1;
+	if(x0 > x1 || y0 > y1) return;
+	
+	int tilePixels = VIDEO_DIRTY_TILE*videoOversample;
+	for(int ty=y0/tilePixels; ty<=y1/tilePixels; ty++) {
+		for(int tx=x0/tilePixels; tx<=x1/tilePixels; tx++) tileState[ty*tileCount.X + tx] |= TILE_DRAWN | TILE_COVERED;
+	}
+}
+
+//! Fills a row from x0 to x1 (inclusive, clipped to the buffer) with one color
+void CVideoDriver::fillSpan(int y, int x0, int x1, Color color)
+{
+	if(y < 0 || y >= videoDimension.Y) return;
+	if(x0 < 0) x0 = 0;
+	if(x1 > videoDimension.X-1) x1 = videoDimension.X-1;
+	if(x0 > x1) return;
+	
+	fillPixels(videoBuffer + y*videoPitch + x0*4, packPixel(color.Red, color.Green, color.Blue), (x1 - x0) + 1);
+}
+
+//! Fills a row from x0 to x1 (inclusive, clipped to the buffer) stepping from color0 to color1
+void CVideoDriver::fillSpanGradient(int y, int x0, int x1, Color color0, Color color1)
+{
+	if(color0 == color1) {
+		fillSpan(y, x0, x1, color0);
+		return;
+	}
+	if(y < 0 || y >= videoDimension.Y) return;
+	
+	//16.16 color stepping (advanced past any clipped pixels)
+	int length = (x1 > x0) ? (x1 - x0) : 1;
+	int red = (color0.Red << FIXED_SHIFT) + FIXED_HALF;
+	int green = (color0.Green << FIXED_SHIFT) + FIXED_HALF;
+	int blue = (color0.Blue << FIXED_SHIFT) + FIXED_HALF;
+	int stepRed = (((int)color1.Red - (int)color0.Red) << FIXED_SHIFT)/length;
+	int stepGreen = (((int)color1.Green - (int)color0.Green) << FIXED_SHIFT)/length;
+	int stepBlue = (((int)color1.Blue - (int)color0.Blue) << FIXED_SHIFT)/length;
+	if(x0 < 0) {
+		red -= stepRed*x0;
+		green -= stepGreen*x0;
+		blue -= stepBlue*x0;
+		x0 = 0;
+	}
+	if(x1 > videoDimension.X-1) x1 = videoDimension.X-1;
+	
+	unsigned char* pixel = videoBuffer + y*videoPitch + x0*4;
+	for(int x=x0; x<=x1; x++, pixel+=4) {
+		unsigned int value = packPixel(red >> FIXED_SHIFT, green >> FIXED_SHIFT, blue >> FIXED_SHIFT);
+		memcpy(pixel, &value, 4);
+		red += stepRed;
+		green += stepGreen;
+		blue += stepBlue;
+	}
+}
 
-    int sx = ZSGN(dx);
-    int sy = ZSGN(dy);
+//! Fills a convex polygon out to every pixel its edges touch (inclusive, the edges are covered like lines)
+void CVideoDriver::fillPolygonCovered(const Vector* pos, const Color* color, int n)
+{
+	if(n < 3) return;
+	if(n > VIDEO_MAX_POLYGON_VERTICES) n = VIDEO_MAX_POLYGON_VERTICES;
+	
+	//only walk the rows the polygon touches
+	int yMin = pos[0].Y;
+	int yMax = pos[0].Y;
+	bool flat = true;
+	for(int i=1; i<n; i++) {
+		if(pos[i].Y < yMin) yMin = pos[i].Y;
+		if(pos[i].Y > yMax) yMax = pos[i].Y;
+		if(color[i] != color[0]) flat = false;
+	}
+	int yStart = (yMin < 0) ? 0 : yMin;
+	int yEnd = (yMax > videoDimension.Y-1) ? videoDimension.Y-1 : yMax;
+	if(yStart > yEnd) return;
+	
+	//every edge top to bottom (flat edges cover their whole row)
+	ScanEdge edges[VIDEO_MAX_POLYGON_VERTICES];
+	for(int i=0; i<n; i++) {
+		int j = (i+1)%n;
+		if(pos[i].Y <= pos[j].Y) edgeSetup(edges[i], pos[i], color[i], pos[j], color[j], yStart);
+		else edgeSetup(edges[i], pos[j], color[j], pos[i], color[i], yStart);
+	}
+	
+	//fill each row between the outermost edge pixels
+	int dirtyLeft = INT_MAX;
+	int dirtyRight = INT_MIN;
+	for(int y=yStart; y<=yEnd; y++) {
+		int left = INT_MAX;
+		int right = INT_MIN;
+		Color leftColor, rightColor;
+		for(int e=0; e<n; e++) edgeCover(edges[e], y, left, right, leftColor, rightColor);
+		if(left > right) continue;
+		if(flat) fillSpan(y, left, right, color[0]);
+		else fillSpanGradient(y, left, right, leftColor, rightColor);
+		if(left < dirtyLeft) dirtyLeft = left;
+		if(right > dirtyRight) dirtyRight = right;
+	}
+	markDirty(dirtyLeft, yStart, dirtyRight, yEnd);
+}
 
-    int x = pos0.X;
-    int y = pos0.Y;
+//! Blends a pixel over the video buffer (alpha 0-256, clipped to the buffer)
+void CVideoDriver::blendPixel(int x, int y, Color color, int alpha)
+{
+	if(x < 0 || x >= videoDimension.X || y < 0 || y >= videoDimension.Y || alpha <= 0) return;
+	unsigned char* pixel = videoBuffer + y*videoPitch + x*4;
+	pixel[0] += (((int)color.Red - (int)pixel[0])*alpha) >> 8;
+	pixel[1] += (((int)color.Green - (int)pixel[1])*alpha) >> 8;
+	pixel[2] += (((int)color.Blue - (int)pixel[2])*alpha) >> 8;
+}
 
-    if(ax >= ay) // x dominant
-    {
-        int yd = ay - (ax >> 1);
-        for(;;) {
-			Color color = color1;
-			if(pos0.X!=pos1.X) color.lerp(color0, (ABS(x-pos1.X)*100)/ABS(pos0.X-pos1.X));
-			else color = color0;
-            drawPoint(Vector(x, y), color);
-			if(mem && memc && y >= 0 && y < videoDimension.Y) {
-				if(x < mem[y][0]) {
-					mem[y][0] = x;
-					memc[y][0] = color;
-				}
-				if(x > mem[y][1]) {
-					mem[y][1] = x;
-					memc[y][1] = color;
-				}
+//! Fills a convex polygon with 16.16 vertices (pixel centers at +0.5), blending by coverage across the edges set in smoothEdges
+void CVideoDriver::fillPolygonSmooth(const int* posX, const int* posY, const Color* color, int n, unsigned int smoothEdges)
+{
+	if(n < 3) return;
+	if(n > VIDEO_MAX_POLYGON_VERTICES) n = VIDEO_MAX_POLYGON_VERTICES;
+	
+	//rows whose centers the polygon spans
+	int yMin = posY[0];
+	int yMax = posY[0];
+	bool flat = true;
+	for(int i=1; i<n; i++) {
+		if(posY[i] < yMin) yMin = posY[i];
+		if(posY[i] > yMax) yMax = posY[i];
+		if(color[i] != color[0]) flat = false;
+	}
+	int yStart = (yMin - FIXED_HALF + FIXED_ONE - 1) >> FIXED_SHIFT;
+	int yEnd = (yMax - FIXED_HALF + FIXED_ONE - 1) >> FIXED_SHIFT;
+	if(yStart < 0) yStart = 0;
+	if(yEnd > videoDimension.Y) yEnd = videoDimension.Y;
+	if(yStart >= yEnd) return;
+	
+	//edges top to bottom (edges that own no row centers are skipped)
+	ScanEdge edges[VIDEO_MAX_POLYGON_VERTICES];
+	int numEdges = 0;
+	for(int i=0; i<n; i++) {
+		int j = (i+1)%n;
+		bool smooth = (smoothEdges >> i) & 1;
+		if(posY[i] < posY[j]) edgeSetupSmooth(edges[numEdges], posX[i], posY[i], color[i], posX[j], posY[j], color[j], smooth, yStart);
+		else edgeSetupSmooth(edges[numEdges], posX[j], posY[j], color[j], posX[i], posY[i], color[i], smooth, yStart);
+		if(edges[numEdges].yTop < edges[numEdges].yBottom) numEdges++;
+	}
+	
+	//edges start at their first row and only step while they own rows
+	int dirtyLeft = INT_MAX;
+	int dirtyRight = INT_MIN;
+	for(int y=yStart; y<yEnd; y++) {
+		ScanEdge* left = 0;
+		ScanEdge* right = 0;
+		for(int e=0; e<numEdges; e++) {
+			ScanEdge& edge = edges[e];
+			if(y < edge.yTop || y >= edge.yBottom) continue;
+			if(!left || edge.x < left->x) left = &edge;
+			if(!right || edge.x > right->x) right = &edge;
+		}
+		if(!left) continue;
+		int xLeft = left->x;
+		int xRight = right->x;
+		Color leftColor = edgeColor(*left);
+		Color rightColor = edgeColor(*right);
+		for(int e=0; e<numEdges; e++) {
+			if(y >= edges[e].yTop && y < edges[e].yBottom) edgeStep(edges[e]);
+		}
+		
+		//pixels whose centers lie inside the edges or within the coverage ramps around them
+		int x0 = (xLeft - left->fringe - FIXED_HALF + FIXED_ONE - 1) >> FIXED_SHIFT;
+		int x1 = ((xRight + right->fringe - FIXED_HALF + FIXED_ONE - 1) >> FIXED_SHIFT) - 1;
+		if(x0 < 0) x0 = 0;
+		if(x1 > videoDimension.X-1) x1 = videoDimension.X-1;
+		if(x0 > x1) continue;
+		if(x0 < dirtyLeft) dirtyLeft = x0;
+		if(x1 > dirtyRight) dirtyRight = x1;
+		
+		//coverage at the first pixel center (hard edges cover fully up to the edge)
+		int center = (x0 << FIXED_SHIFT) + FIXED_HALF;
+		int coverLeft = FIXED_ONE;
+		int coverRight = FIXED_ONE;
+		if(left->coverStep) coverLeft = FIXED_HALF + (int)(((long long)(center - xLeft)*left->coverStep) >> FIXED_SHIFT);
+		if(right->coverStep) coverRight = FIXED_HALF + (int)(((long long)(xRight - center)*right->coverStep) >> FIXED_SHIFT);
+		
+		//16.16 color stepping across the span (clamped in the fringes)
+		int red = (leftColor.Red << FIXED_SHIFT) + FIXED_HALF;
+		int green = (leftColor.Green << FIXED_SHIFT) + FIXED_HALF;
+		int blue = (leftColor.Blue << FIXED_SHIFT) + FIXED_HALF;
+		int stepRed = 0, stepGreen = 0, stepBlue = 0;
+		if(!flat) {
+			int length = (xRight - xLeft) >> FIXED_SHIFT;
+			if(length < 1) length = 1;
+			stepRed = (((int)rightColor.Red - (int)leftColor.Red) << FIXED_SHIFT)/length;
+			stepGreen = (((int)rightColor.Green - (int)leftColor.Green) << FIXED_SHIFT)/length;
+			stepBlue = (((int)rightColor.Blue - (int)leftColor.Blue) << FIXED_SHIFT)/length;
+			int offset = (center - xLeft) >> FIXED_SHIFT;
+			red += stepRed*offset;
+			green += stepGreen*offset;
+			blue += stepBlue*offset;
+		}
+		
+		//fully covered pixels of a flat polygon are filled in one go
+		int innerStart = (xLeft + left->fringe - FIXED_HALF + FIXED_ONE - 1) >> FIXED_SHIFT;
+		int innerEnd = ((xRight - right->fringe - FIXED_HALF + FIXED_ONE - 1) >> FIXED_SHIFT) - 1;
+		if(!flat || innerStart < x0) innerStart = x0;
+		if(innerEnd > x1) innerEnd = x1;
+		
+		unsigned char* pixel = videoBuffer + y*videoPitch + x0*4;
+		for(int x=x0; x<=x1; x++, pixel+=4) {
+			if(flat && x == innerStart && innerStart <= innerEnd) {
+				int skip = innerEnd - innerStart;
+				fillSpan(y, innerStart, innerEnd, color[0]);
+				x += skip;
+				pixel += skip*4;
+				coverLeft += left->coverStep*(skip+1);
+				coverRight -= right->coverStep*(skip+1);
+				continue;
 			}
-            
-			if (x == pos1.X) return;
-            if (yd >= 0) {
-                y += sy;
-                yd -= ax;
-            }
-
-            x += sx;
-            yd += ay;
-        }
-    }
-    else if(ay >= ax) // y dominant
-    {
-        int xd = ax - (ay >> 1);
-        for(;;) {
-			Color color = color1;
-			if(pos0.Y!=pos1.Y) color.lerp(color0, (ABS(y-pos1.Y)*100)/ABS(pos0.Y-pos1.Y));
-			else color = color0;
-            drawPoint(Vector(x, y), color);
-			if(mem && memc && y >= 0 && y < videoDimension.Y) {
-				if(x < mem[y][0]) {
-					mem[y][0] = x;
-					memc[y][0] = color;
-				}
-				if(x > mem[y][1]) {
-					mem[y][1] = x;
-					memc[y][1] = color;
+			int coverage = (coverLeft < coverRight) ? coverLeft : coverRight;
+			if(coverage > 0) {
+				int alpha = (coverage >= FIXED_ONE) ? 256 : (coverage >> (FIXED_SHIFT-8));
+				int r = red >> FIXED_SHIFT, g = green >> FIXED_SHIFT, b = blue >> FIXED_SHIFT;
+				if(!flat) {
+					r = (r < 0) ? 0 : (r > 255) ? 255 : r;
+					g = (g < 0) ? 0 : (g > 255) ? 255 : g;
+					b = (b < 0) ? 0 : (b > 255) ? 255 : b;
 				}
+				pixel[0] += ((r - (int)pixel[0])*alpha) >> 8;
+				pixel[1] += ((g - (int)pixel[1])*alpha) >> 8;
+				pixel[2] += ((b - (int)pixel[2])*alpha) >> 8;
 			}
-			
-            if(y == pos1.Y) return;
-            if(xd >= 0) {
-                x += sx;
-                xd -= ay;
-            }
+			coverLeft += left->coverStep;
+			coverRight -= right->coverStep;
+			red += stepRed;
+			green += stepGreen;
+			blue += stepBlue;
+		}
+	}
+	markDirty(dirtyLeft, yStart, dirtyRight, yEnd-1);
+}
 
-            y += sy;
-            xd += ax;
-        }
-    }
+//helper functions
+static void edgeSetup(ScanEdge& edge, Vector top, Color topColor, Vector bottom, Color bottomColor, int y) {
+	int rows = bottom.Y - top.Y;
+	edge.yTop = top.Y;
+	edge.yBottom = bottom.Y;
+	edge.xMin = ((top.X < bottom.X) ? top.X : bottom.X) << FIXED_SHIFT;
+	edge.xMax = ((top.X < bottom.X) ? bottom.X : top.X) << FIXED_SHIFT;
+	edge.step = (rows > 0) ? ((bottom.X - top.X) << FIXED_SHIFT)/rows : 0;
+	edge.x = (top.X << FIXED_SHIFT) + edge.step*(y - top.Y);
+	edge.colorMin = (top.X < bottom.X) ? topColor : bottomColor;
+	edge.colorMax = (top.X < bottom.X) ? bottomColor : topColor;
+	
+	int topValues[3] = {topColor.Red, topColor.Green, topColor.Blue};
+	int bottomValues[3] = {bottomColor.Red, bottomColor.Green, bottomColor.Blue};
+	bool gradient = (rows > 0 && topColor != bottomColor);
+	for(int c=0; c<3; c++) {
+		edge.colorStep[c] = gradient ? ((bottomValues[c] - topValues[c]) << FIXED_SHIFT)/rows : 0;
+		edge.color[c] = (topValues[c] << FIXED_SHIFT) + FIXED_HALF + edge.colorStep[c]*(y - top.Y);
+	}
+}
+static void edgeCover(ScanEdge& edge, int y, int& left, int& right, Color& leftColor, Color& rightColor) {
+	//widen the span by the x range the edge passes through within this row (half a row up and down)
+	if(y >= edge.yTop && y <= edge.yBottom) {
+		int xLeft = edge.xMin;
+		int xRight = edge.xMax;
+		Color colorLeft = edge.colorMin;
+		Color colorRight = edge.colorMax;
+		if(edge.yBottom > edge.yTop) {
+			int half = ABS(edge.step)/2;
+			if(edge.x - half > xLeft) xLeft = edge.x - half;
+			if(edge.x + half < xRight) xRight = edge.x + half;
+			colorLeft = colorRight = edgeColor(edge);
+		}
+		
+		//pixels whose centers the edge reaches (and always the one under the edge itself)
+		int center = (((edge.x < edge.xMin) ? edge.xMin : (edge.x > edge.xMax) ? edge.xMax : edge.x) + FIXED_HALF) >> FIXED_SHIFT;
+		xLeft = (xLeft + FIXED_ONE - 1) >> FIXED_SHIFT;
+		xRight = ((xRight + FIXED_ONE - 1) >> FIXED_SHIFT) - 1;
+		if(xLeft > center) xLeft = center;
+		if(xRight < center) xRight = center;
+		if(xLeft < left) {
+			left = xLeft;
+			leftColor = colorLeft;
+		}
+		if(xRight > right) {
+			right = xRight;
+			rightColor = colorRight;
+		}
+	}
+	edgeStep(edge);
+}
+static void edgeStep(ScanEdge& edge) {
+	edge.x += edge.step;
+	for(int c=0; c<3; c++) edge.color[c] += edge.colorStep[c];
+}
+static Color edgeColor(const ScanEdge& edge) {
+	return Color(edge.color[0] >> FIXED_SHIFT, edge.color[1] >> FIXED_SHIFT, edge.color[2] >> FIXED_SHIFT);
+}
+static void segmentNormal(Vector a, Vector b, float* normal) {
+	//unit normal of the segment (repeated points leave the given normal untouched)
+	float dx = b.X - a.X;
+	float dy = b.Y - a.Y;
+	float length = sqrtf(dx*dx + dy*dy);
+	if(length > 0) {
+		normal[0] = -dy/length;
+		normal[1] = dx/length;
+	}
+}
+static bool strokeJoint(const float* normal0, const float* normal1, float halfWidth, float* offset) {
+	//miter joint (the average normal shortens as the joint gets sharper, the offset grows up to the limit and past it the joint is beveled)
+	float nx = (normal0[0] + normal1[0])*0.5f;
+	float ny = (normal0[1] + normal1[1])*0.5f;
+	float length = sqrtf(nx*nx + ny*ny);
+	if(length < 1.0f/VIDEO_MITER_LIMIT) return false;
+	float scale = halfWidth/(length*length);
+	offset[0] = nx*scale;
+	offset[1] = ny*scale;
+	return true;
+}
+static void edgeSetupSmooth(ScanEdge& edge, int topX, int topY, Color topColor, int bottomX, int bottomY, Color bottomColor, bool smooth, int y) {
+	//rows whose centers (at +0.5) the edge spans, with x and color at the center of the first one walked
+	edge.yTop = (topY - FIXED_HALF + FIXED_ONE - 1) >> FIXED_SHIFT;
+	edge.yBottom = (bottomY - FIXED_HALF + FIXED_ONE - 1) >> FIXED_SHIFT;
+	if(y < edge.yTop) y = edge.yTop;
+	if(y >= edge.yBottom) {
+		edge.yBottom = edge.yTop;
+		return;
+	}
+	long long height = bottomY - topY;
+	long long start = ((long long)y << FIXED_SHIFT) + FIXED_HALF - topY;
+	edge.step = (int)(((long long)(bottomX - topX) << FIXED_SHIFT)/height);
+	edge.x = topX + (int)((start*edge.step) >> FIXED_SHIFT);
+	
+	int topValues[3] = {topColor.Red, topColor.Green, topColor.Blue};
+	int bottomValues[3] = {bottomColor.Red, bottomColor.Green, bottomColor.Blue};
+	bool gradient = (topColor != bottomColor);
+	for(int c=0; c<3; c++) {
+		edge.colorStep[c] = gradient ? (int)(((long long)(bottomValues[c] - topValues[c]) << (FIXED_SHIFT*2))/height) : 0;
+		edge.color[c] = (topValues[c] << FIXED_SHIFT) + FIXED_HALF + (int)((start*edge.colorStep[c]) >> FIXED_SHIFT);
+	}
+	
+	//coverage falls off with the distance from the edge line, measured along the row
+	edge.coverStep = 0;
+	edge.fringe = 0;
+	if(smooth) {
+		float slope = (float)edge.step/FIXED_ONE;
+		float stretch = sqrtf(1.0f + slope*slope);
+		edge.coverStep = (int)(FIXED_ONE/stretch);
+		edge.fringe = (int)(FIXED_HALF*stretch);
+	}
+}
+static int lineMinorSteps(int ax, int ay, int error, int step) {
+	//minor steps a bresenham walk has taken before the given step (its error stays in [ay-ax, ay))
+	return (int)floorDiv((long long)error + (long long)(step-1)*ay, ax) + 1;
+}
+static void lineClip(int minor0, int minorSign, int minorSize, int ax, int ay, int error, int& first, int& last) {
+	if(minorSign == 0) {
+		if(minor0 < 0 || minor0 >= minorSize) last = first-1;
+		return;
+	}
+	
+	//minor steps that stay inside the viewport and the first and last step taking them
+	int low = (minorSign > 0) ? -minor0 : minor0 - (minorSize-1);
+	int high = (minorSign > 0) ? (minorSize-1) - minor0 : minor0;
+	if(high < 0) {
+		last = first-1;
+		return;
+	}
+	if(low > 0) {
+		long long step = 1 - floorDiv(-((long long)(low-1)*ax - error), ay);
+		if(step > first) first = (step > last) ? last+1 : (int)step;
+	}
+	long long step = -floorDiv(-((long long)high*ax - error), ay);
+	if(step < last) last = (step < first) ? first-1 : (int)step;
+}
+static long long floorDiv(long long a, long long b) {
+	long long q = a/b;
+	if((a%b != 0) && ((a < 0) != (b < 0))) q--;
+	return q;
+}
+static unsigned int packPixel(unsigned char red, unsigned char green, unsigned char blue) {
+	//bytes in memory are red, green, blue, unused
+	unsigned char bytes[4] = {red, green, blue, 0};
+	unsigned int value;
+	memcpy(&value, bytes, 4);
+	return value;
+}
+static void fillPixels(unsigned char* pixel, unsigned int value, int count) {
+	int i = 0;
+#if defined(VIDEO_SIMD_NEON)
+	uint32x4_t values = vdupq_n_u32(value);
+	for(; i+4<=count; i+=4) vst1q_u32((uint32_t*)(pixel + i*4), values);
+#elif defined(VIDEO_SIMD_SSE2)
+	__m128i values = _mm_set1_epi32(value);
+	for(; i+4<=count; i+=4) _mm_storeu_si128((__m128i*)(pixel + i*4), values);
+#endif
+	for(; i<count; i++) memcpy(pixel + i*4, &value, 4);
+}
+static void copyPixels(unsigned char* destination, const unsigned char* source, int count) {
+	//forward when moving left and backward when moving right, so an overlapping row is read before it is overwritten
+	int bytes = count*4;
+	if(destination <= source) {
+		int i = 0;
+#if defined(VIDEO_SIMD_NEON)
+		for(; i+16<=bytes; i+=16) vst1q_u8(destination + i, vld1q_u8(source + i));
+#elif defined(VIDEO_SIMD_SSE2)
+		for(; i+16<=bytes; i+=16) _mm_storeu_si128((__m128i*)(destination + i), _mm_loadu_si128((const __m128i*)(source + i)));
+#endif
+		for(; i<bytes; i++) destination[i] = source[i];
+	} else {
+		int i = bytes;
+#if defined(VIDEO_SIMD_NEON)
+		for(; i>=16; i-=16) vst1q_u8(destination + i-16, vld1q_u8(source + i-16));
+#elif defined(VIDEO_SIMD_SSE2)
+		for(; i>=16; i-=16) _mm_storeu_si128((__m128i*)(destination + i-16), _mm_loadu_si128((const __m128i*)(source + i-16)));
+#endif
+		for(; i>0; i--) destination[i-1] = source[i-1];
+	}
+}
+static void downsample(const unsigned char* source, int pitch, unsigned char* out, int count, int factor) {
+	switch(factor) {
+		case 1: downsampleRow<1>(source, pitch, out, count, 1); break;
+		case 2: downsampleRow<2>(source, pitch, out, count, 2); break;
+		case 3: downsampleRow<3>(source, pitch, out, count, 3); break;
+		case 4: downsampleRow<4>(source, pitch, out, count, 4); break;
+		default: downsampleRow<0>(source, pitch, out, count, factor); break;
+	}
+}
+template<int FACTOR> static void downsampleRow(const unsigned char* source, int pitch, unsigned char* out, int count, int factor) {
+	//box filter factor x factor blocks into packed rgb (a given FACTOR turns the loops and the divide into constants)
+	int size = FACTOR ? FACTOR : factor;
+	unsigned int area = size*size;
+	for(int x=0; x<count; x++, source+=size*4, out+=3) {
+		unsigned int red = 0;
+		unsigned int green = 0;
+		unsigned int blue = 0;
+		for(int yp=0; yp<size; yp++) {
+			const unsigned char* pixel = source + yp*pitch;
+			for(int xp=0; xp<size; xp++, pixel+=4) {
+				red += pixel[0];
+				green += pixel[1];
+				blue += pixel[2];
+			}
+		}
+		out[0] = red/area;
+		out[1] = green/area;
+		out[2] = blue/area;
+	}
+}
+#if defined(VIDEO_SIMD_NEON)
+template<> void downsampleRow<2>(const unsigned char* source, int pitch, unsigned char* out, int count, int /*factor*/) {
+	//two blocks per step: 16 bit sums of both rows, then of each pixel pair, shifted down by 2
+	int x = 0;
+	for(; x+2<=count; x+=2, source+=16, out+=6) {
+		uint8x16_t top = vld1q_u8(source);
+		uint8x16_t bottom = vld1q_u8(source + pitch);
+		uint16x8_t low = vaddl_u8(vget_low_u8(top), vget_low_u8(bottom));
+		uint16x8_t high = vaddl_u8(vget_high_u8(top), vget_high_u8(bottom));
+		uint16x8_t sums = vaddq_u16(vcombine_u16(vget_low_u16(low), vget_low_u16(high)), vcombine_u16(vget_high_u16(low), vget_high_u16(high)));
+		unsigned char bytes[8];
+		vst1_u8(bytes, vshrn_n_u16(sums, 2));
+		memcpy(out, bytes, 3);
+		memcpy(out + 3, bytes + 4, 3);
+	}
+	downsampleRow<0>(source, pitch, out, count - x, 2);
+}
+template<> void downsampleRow<4>(const unsigned char* source, int pitch, unsigned char* out, int count, int /*factor*/) {
+	//one block per step: 16 bit sums of the four rows, then of the four pixels, shifted down by 4
+	for(int x=0; x<count; x++, source+=16, out+=3) {
+		uint16x8_t low = vdupq_n_u16(0);
+		uint16x8_t high = vdupq_n_u16(0);
+		for(int yp=0; yp<4; yp++) {
+			uint8x16_t row = vld1q_u8(source + yp*pitch);
+			low = vaddw_u8(low, vget_low_u8(row));
+			high = vaddw_u8(high, vget_high_u8(row));
+		}
+		uint16x8_t pairs = vaddq_u16(low, high);
+		uint16x4_t sums = vadd_u16(vget_low_u16(pairs), vget_high_u16(pairs));
+		unsigned char bytes[8];
+		vst1_u8(bytes, vshrn_n_u16(vcombine_u16(sums, sums), 4));
+		memcpy(out, bytes, 3);
+	}
+}
+#elif defined(VIDEO_SIMD_SSE2)
+template<> void downsampleRow<2>(const unsigned char* source, int pitch, unsigned char* out, int count, int /*factor*/) {
+	//two blocks per step: 16 bit sums of both rows, then of each pixel pair, shifted down by 2
+	const __m128i zero = _mm_setzero_si128();
+	int x = 0;
+	for(; x+2<=count; x+=2, source+=16, out+=6) {
+		__m128i top = _mm_loadu_si128((const __m128i*)source);
+		__m128i bottom = _mm_loadu_si128((const __m128i*)(source + pitch));
+		__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+		__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+		__m128i sums = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+		sums = _mm_srli_epi16(sums, 2);
+		unsigned char bytes[8];
+		_mm_storel_epi64((__m128i*)bytes, _mm_packus_epi16(sums, sums));
+		memcpy(out, bytes, 3);
+		memcpy(out + 3, bytes + 4, 3);
+	}
+	downsampleRow<0>(source, pitch, out, count - x, 2);
+}
+template<> void downsampleRow<4>(const unsigned char* source, int pitch, unsigned char* out, int count, int /*factor*/) {
+	//one block per step: 16 bit sums of the four rows, then of the four pixels, shifted down by 4
+	const __m128i zero = _mm_setzero_si128();
+	for(int x=0; x<count; x++, source+=16, out+=3) {
+		__m128i low = zero;
+		__m128i high = zero;
+		for(int yp=0; yp<4; yp++) {
+			__m128i row = _mm_loadu_si128((const __m128i*)(source + yp*pitch));
+			low = _mm_add_epi16(low, _mm_unpacklo_epi8(row, zero));
+			high = _mm_add_epi16(high, _mm_unpackhi_epi8(row, zero));
+		}
+		__m128i sums = _mm_add_epi16(low, high);
+		sums = _mm_add_epi16(sums, _mm_srli_si128(sums, 8));
+		sums = _mm_srli_epi16(sums, 4);
+		unsigned int value = _mm_cvtsi128_si32(_mm_packus_epi16(sums, sums));
+		memcpy(out, &value, 3);
+	}
 }
+#endif
@@ -9,6 +9,11 @@
 #include "Vector.h"
 #include "Color.h"
 
+#define VIDEO_MAX_POLYGON_VERTICES 16
+#define VIDEO_MITER_LIMIT 2.0f
+#define VIDEO_ROW_ALIGN 16
+#define VIDEO_DIRTY_TILE 8
+
 //! Class that performs all the rendering to the raw data buffer (8 bit encoding)
 class CVideoDriver
 {
@@ -39,6 +44,9 @@ public:
 	
 	//! Gets the oversample value (width of one pixel)
 	unsigned int getOversample() const;
+	
+	//! Gets the fraction of the display area that changed in the last flush (0-1)
+	float getChangedFraction() const;
 
 	//! Draws a point
 	void drawPoint(Vector pos, Color color);
@@ -49,14 +57,56 @@ public:
 	//! Draws a triangle
 	void drawTri(Vector pos0, Color color0, Vector pos1, Color color1, Vector pos2, Color color2);
 
-	//! Draws a quad
+	//! Draws a convex quad (edges covered like drawTri, so thin quads keep their pixels and neighbours overlap on shared edges)
 	void drawQuad(Vector pos0, Color color0, Vector pos1, Color color1, Vector pos2, Color color2, Vector pos3, Color color3);
 
+	//! Draws a convex polygon of up to VIDEO_MAX_POLYGON_VERTICES (edges shared with a neighbouring polygon are only drawn once)
+	void drawPolygon(const Vector* pos, const Color* color, int n);
+
+	//! Draws connected lines through the points as one stroke width pixels wide (joints share their vertices, past VIDEO_MITER_LIMIT they are beveled)
+	void drawPolyline(const Vector* points, int count, int width, Color color);
+
+	//! Draws connected lines through the points with an outline outlineWidth pixels wide on both sides
+	void drawPolylineOutlined(const Vector* points, int count, int width, Color color, int outlineWidth, Color outlineColor);
+
+	//! Blends a point over the video buffer (alpha 0-255)
+	void blendPoint(Vector pos, Color color, unsigned char alpha);
+
+	//! Draws an anti-aliased line (each step is split between the two pixels the line passes between)
+	void drawLineAA(Vector pos0, Color color0, Vector pos1, Color color1);
+
+	//! Draws a convex polygon with anti-aliased edges (coverage blended over the buffer, vertices on pixel corners like drawPolygon, bit i of smoothEdges smooths the edge from vertex i)
+	void drawPolygonAA(const Vector* pos, const Color* color, int n, unsigned int smoothEdges = ~0u);
+
+	//! Draws connected lines through the points as one stroke width pixels wide with anti-aliased sides and ends
+	void drawPolylineAA(const Vector* points, int count, int width, Color color);
+
+	//! Draws an anti-aliased stroke with an outline outlineWidth pixels wide on both sides
+	void drawPolylineOutlinedAA(const Vector* points, int count, int width, Color color, int outlineWidth, Color outlineColor);
+
+	//! Fills a rectangle with one color (clipped to the buffer)
+	void fillRect(Vector pos, Vector size, Color color);
+
+	//! Copies a rectangle of the video buffer to another position (clipped to the buffer, the two may overlap)
+	void copyRect(Vector from, Vector size, Vector to);
+
+	//! Copies the video buffer out as RGB888 (3 bytes per pixel, rows stride bytes apart)
+	void copyToRGB(unsigned char* rgb, int stride) const;
+
 	//! Sends the video data to the display
 	void flush();
 
 private:
-	unsigned char* videoBuffer;
+	unsigned char* videoMemory;
+	unsigned char* videoBuffer;     //32 bit pixels (red, green, blue, unused) in rows of videoPitch bytes
+	int videoBufferSize;
+	int videoPitch;
+	unsigned char* displayBuffer;   //display sized rgb frame the video buffer is averaged into (plus one row of scratch)
+	int* displayMap;                //led position of each displayBuffer pixel (-1 if it is not shown)
+	unsigned char* tileState;       //TILE_ flags for each VIDEO_DIRTY_TILE square of display pixels
+	Vector tileCount;
+	unsigned int clearValue;        //packed color of the last clear (tiles not drawn on since still hold it)
+	float changedFraction;
 	unsigned int videoOversample;
 	Vector videoSize;
 	unsigned int videoBaseRotation;
@@ -71,8 +121,26 @@ private:
 	//! Calculates the mirror and dimension values for a given angle
 	void calcRotation(int angle);
 	
-	//! Draws a line and records the outline to memory
-	void drawLine_mem(Vector pos0, Color color0, Vector pos1, Color color1, int mem[][2], Color memc[][2]);
+	//! Calculates the led position each display buffer pixel is shown at for the current rotation
+	void calcDisplayMap();
+	
+	//! Marks the tiles a rectangle of the video buffer touches as drawn on (inclusive, clipped to the buffer)
+	void markDirty(int x0, int y0, int x1, int y1);
+	
+	//! Fills a row from x0 to x1 (inclusive, clipped to the buffer) with one color
+	void fillSpan(int y, int x0, int x1, Color color);
+	
+	//! Fills a row from x0 to x1 (inclusive, clipped to the buffer) stepping from color0 to color1
+	void fillSpanGradient(int y, int x0, int x1, Color color0, Color color1);
+	
+	//! Fills a convex polygon out to every pixel its edges touch (inclusive, the edges are covered like lines)
+	void fillPolygonCovered(const Vector* pos, const Color* color, int n);
+	
+	//! Blends a pixel over the video buffer (alpha 0-256, clipped to the buffer)
+	void blendPixel(int x, int y, Color color, int alpha);
+	
+	//! Fills a convex polygon with 16.16 vertices (pixel centers at +0.5), blending by coverage across the edges set in smoothEdges
+	void fillPolygonSmooth(const int* posX, const int* posY, const Color* color, int n, unsigned int smoothEdges);
 };
 
 #endif
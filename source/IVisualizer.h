@@ -30,6 +30,9 @@ public:
 	//! Gets the visualizer style
 	virtual int getStyle()=0;
 	
+	//! Gets the sound analysis features the current style uses (SND_FEATURE_* flags)
+	virtual int getFeatures()=0;
+	
 	//! Clears all resources of the visualizer
 	virtual void clear()=0;
 	
@@ -0,0 +1,113 @@
+#include "fbk.h"
+#include <math.h>
+
+// Band settings (center frequency, bandwidth Q, envelope attack and release in seconds)
+static const double fbk_bandFrequency[FBK_NUM_BANDS] = { 40.0, 90.0, 250.0, 8000.0 };
+static const double fbk_bandQ[FBK_NUM_BANDS] = { 0.7, 1.0, 0.8, 0.7 };
+static const double fbk_bandAttack[FBK_NUM_BANDS] = { 0.005, 0.002, 0.001, 0.0005 };
+static const double fbk_bandRelease[FBK_NUM_BANDS] = { 0.080, 0.060, 0.040, 0.025 };
+
+// Filter state for one band (band pass biquad, direct form 1)
+struct FBKFilterState {
+	double x1, x2;
+	double y1, y2;
+	double envelope;
+};
+
+// Data
+static double fbk_b0[FBK_NUM_BANDS];                     /* Biquad feed forward coefficients (b1 is zero, b2 is -b0) */
+static double fbk_a1[FBK_NUM_BANDS];                     /* Biquad feedback coefficients */
+static double fbk_a2[FBK_NUM_BANDS];
+static double fbk_attackCoef[FBK_NUM_BANDS];             /* Per sample envelope coefficients */
+static double fbk_releaseCoef[FBK_NUM_BANDS];
+static struct FBKFilterState fbk_state[FBK_NUM_BANDS];
+
+// Published values (written by the sound thread, read by anyone)
+static float fbk_envelope[FBK_NUM_BANDS];
+
+// Helper Functions
+static void fbk_publish(float* value, float newValue);
+static float fbk_read(float* value);
+
+// Setup and initialize the Filterbank utils for the given sample rate
+int fbk_init(unsigned int sampleRate)
+{
+	int b;
+	for(b=0; b<FBK_NUM_BANDS; b++) {
+
+		//band pass with 0dB peak gain (bands above nyquist are left silent)
+		double w0 = 2.0*M_PI*fbk_bandFrequency[b]/sampleRate;
+		if(w0 >= M_PI) w0 = M_PI*0.99;
+		double alpha = sin(w0)/(2.0*fbk_bandQ[b]);
+		double a0 = 1.0 + alpha;
+		fbk_b0[b] = alpha/a0;
+		fbk_a1[b] = -2.0*cos(w0)/a0;
+		fbk_a2[b] = (1.0 - alpha)/a0;
+		if(fbk_bandFrequency[b] >= sampleRate/2.0) fbk_b0[b] = 0;
+
+		//peak follower on the rectified output (release long enough to bridge the band's half cycles)
+		fbk_attackCoef[b] = 1.0 - exp(-1.0/(fbk_bandAttack[b]*sampleRate));
+		fbk_releaseCoef[b] = 1.0 - exp(-1.0/(fbk_bandRelease[b]*sampleRate));
+	}
+	fbk_reset();
+	return 0;
+}
+
+// Clears the filter and envelope state
+void fbk_reset()
+{
+	int b;
+	for(b=0; b<FBK_NUM_BANDS; b++) {
+		fbk_state[b].x1 = fbk_state[b].x2 = 0;
+		fbk_state[b].y1 = fbk_state[b].y2 = 0;
+		fbk_state[b].envelope = 0;
+		fbk_publish(&fbk_envelope[b], 0);
+	}
+}
+
+// Feeds interleaved stereo frames through the filterbank (called from the sound thread)
+void fbk_process(const signed short* buffer, unsigned int numFrames)
+{
+	int i, b;
+	for(b=0; b<FBK_NUM_BANDS; b++) {
+		struct FBKFilterState* state = &fbk_state[b];
+		double b0 = fbk_b0[b];
+		double a1 = fbk_a1[b];
+		double a2 = fbk_a2[b];
+		double attack = fbk_attackCoef[b];
+		double release = fbk_releaseCoef[b];
+		for(i=0; i<numFrames; i++) {
+			double x = (buffer[i*2 +0] + buffer[i*2 +1])/65536.0;
+			double y = b0*(x - state->x2) - a1*state->y1 - a2*state->y2;
+			state->x2 = state->x1;
+			state->x1 = x;
+			state->y2 = state->y1;
+			state->y1 = y;
+
+			double level = (y < 0) ? -y : y;
+			state->envelope += (level - state->envelope)*((level > state->envelope) ? attack : release);
+		}
+
+		//flush denormals out of the silent tails
+		if(fabs(state->y1) < 1e-20 && fabs(state->y2) < 1e-20) state->y1 = state->y2 = 0;
+		if(state->envelope < 1e-20) state->envelope = 0;
+		fbk_publish(&fbk_envelope[b], state->envelope);
+	}
+}
+
+// Gets the envelope of a band as of the last processed sample [0-1]
+float fbk_getEnvelope(int band)
+{
+	if(band < 0 || band >= FBK_NUM_BANDS) return 0;
+	return fbk_read(&fbk_envelope[band]);
+}
+
+//helper functions
+static void fbk_publish(float* value, float newValue) {
+	__atomic_store(value, &newValue, __ATOMIC_RELEASE);
+}
+static float fbk_read(float* value) {
+	float result;
+	__atomic_load(value, &result, __ATOMIC_ACQUIRE);
+	return result;
+}
@@ -0,0 +1,22 @@
+#ifndef FBK_H
+#define FBK_H
+
+#define FBK_BAND_SUB 0     /* ~40Hz sub bass */
+#define FBK_BAND_KICK 1    /* ~90Hz kick drum */
+#define FBK_BAND_SNARE 2   /* ~250Hz snare body */
+#define FBK_BAND_HATS 3    /* ~8kHz hi-hats and cymbals */
+#define FBK_NUM_BANDS 4
+
+// Setup and initialize the Filterbank utils for the given sample rate
+int fbk_init(unsigned int sampleRate);
+
+// Clears the filter and envelope state
+void fbk_reset();
+
+// Feeds interleaved stereo frames through the filterbank (called from the sound thread)
+void fbk_process(const signed short* buffer, unsigned int numFrames);
+
+// Gets the envelope of a band as of the last processed sample [0-1]
+float fbk_getEnvelope(int band);
+
+#endif /* FBK_H */
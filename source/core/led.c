@@ -7,6 +7,10 @@
 #define DRIVER_MODE_PANEL 1
 #define DRIVER_MODE_STRIP 2
 
+#define STRIP_LAYOUT_NONE 0
+#define STRIP_LAYOUT_XY 1
+#define STRIP_LAYOUT_YX 2
+
 //data
 static int led_driverMode = DRIVER_MODE_NONE;
 
@@ -18,6 +22,7 @@ static struct LEDPanelOptions led_panelOptions;
 //strip driver data
 ws2811_t led_string;
 static struct LEDStripOptions led_stripOptions;
+static int led_stripLayout = STRIP_LAYOUT_NONE;
 
 // Setup and initialize the LED Display utils
 int led_init(struct LEDPanelOptions* panelOptions, struct LEDStripOptions* stripOptions)
@@ -60,6 +65,9 @@ int led_init(struct LEDPanelOptions* panelOptions, struct LEDStripOptions* strip
 	} else if(stripOptions) {
 		memcpy(&led_stripOptions, stripOptions, sizeof(led_stripOptions));
 		led_driverMode = DRIVER_MODE_STRIP;
+		led_stripLayout = STRIP_LAYOUT_NONE;
+		if(strcmp(led_stripOptions.layout, "YX")==0) led_stripLayout = STRIP_LAYOUT_YX;
+		else if(strcmp(led_stripOptions.layout, "XY")==0) led_stripLayout = STRIP_LAYOUT_XY;
 		
 		//load strip based driver
 		int stripType = WS2811_STRIP_GRB;
@@ -120,6 +128,19 @@ void led_fill(unsigned char red, unsigned char green, unsigned char blue)
 
 // Writes a color value to the LED Display buffer at the given position
 void led_write(int x, int y, unsigned char red, unsigned char green, unsigned char blue)
+{
+	int n = led_getIndex(x, y);
+	if(n < 0) return;
+	if(led_driverMode == DRIVER_MODE_PANEL) {
+		led_canvas_set_pixel(led_canvas, n & 0xFFFF, n >> 16, red, green, blue);
+	} else if(led_driverMode == DRIVER_MODE_STRIP) {
+		int color = ((int)(red) << 16) + ((int)(green) << 8) + ((int)(blue) << 0);
+		led_string.channel[0].leds[n] = color;
+	}
+}
+
+// Gets the LED Display buffer position for a display position with mirroring and strip layout applied (-1 if not shown)
+int led_getIndex(int x, int y)
 {
 	//mirror and dimensions
 	int dimension_x = 0;
@@ -135,22 +156,46 @@ void led_write(int x, int y, unsigned char red, unsigned char green, unsigned ch
 		if(led_stripOptions.mirror_x > 0) x = (dimension_x-1) - x;
 		if(led_stripOptions.mirror_y > 0) y = (dimension_y-1) - y;
 	}
+	if(x >= dimension_x || x < 0 || y >= dimension_y || y < 0) return -1;
 	
-	//draw
-	if(x < dimension_x && x >= 0 && y < dimension_y && y >= 0) {
-		if(led_driverMode == DRIVER_MODE_PANEL) {
-			led_canvas_set_pixel(led_canvas, x, y, red, green, blue);
-		} else if(led_driverMode == DRIVER_MODE_STRIP) {
-			int n=led_stripOptions.skip;
-			if(strcmp(led_stripOptions.layout, "YX")==0) {
-				if((y%2)==1) x = (led_stripOptions.dimension_x-1) - x;
-				n += y*led_stripOptions.dimension_x + x;
-			} else if(strcmp(led_stripOptions.layout, "XY")==0) {
-				if((x%2)==1) y = (led_stripOptions.dimension_y-1) - y;
-				n += x*led_stripOptions.dimension_y + y;
+	//panel positions hold the canvas row and column, strip positions follow the serpentine layout after the skipped leds
+	if(led_driverMode == DRIVER_MODE_PANEL) return (y << 16) | x;
+	int n=led_stripOptions.skip;
+	if(led_stripLayout == STRIP_LAYOUT_YX) {
+		if((y%2)==1) x = (led_stripOptions.dimension_x-1) - x;
+		n += y*led_stripOptions.dimension_x + x;
+	} else if(led_stripLayout == STRIP_LAYOUT_XY) {
+		if((x%2)==1) y = (led_stripOptions.dimension_y-1) - y;
+		n += x*led_stripOptions.dimension_y + y;
+	}
+	if(n >= led_string.channel[0].count) return -1;
+	return n;
+}
+
+// Writes count packed rgb values to the LED Display buffer at the given positions from led_getIndex (-1 skips a value)
+void led_writeIndexed(const unsigned char* rgb, const int* index, int count)
+{
+	int i;
+	if(led_driverMode == DRIVER_MODE_PANEL) {
+		for(i=0; i<count; i++) {
+			if(index[i] < 0) continue;
+#ifndef LED_PANEL_NO_SET_PIXELS
+			//consecutive positions on a canvas row (unmirrored) are already laid out like the canvas colors and go over in one call
+			int run = 1;
+			while(i+run < count && index[i+run] == index[i]+run) run++;
+			if(run > 1) {
+				led_canvas_set_pixels(led_canvas, index[i] & 0xFFFF, index[i] >> 16, run, 1, (struct Color*)(rgb + i*3));
+				i += run-1;
+				continue;
 			}
-			int color = ((int)(red) << 16) + ((int)(green) << 8) + ((int)(blue) << 0);
-			led_string.channel[0].leds[n] = color;
+#endif
+			led_canvas_set_pixel(led_canvas, index[i] & 0xFFFF, index[i] >> 16, rgb[i*3], rgb[i*3+1], rgb[i*3+2]);
+		}
+	} else if(led_driverMode == DRIVER_MODE_STRIP) {
+		ws2811_led_t* leds = led_string.channel[0].leds;
+		for(i=0; i<count; i++, rgb+=3) {
+			if(index[i] < 0) continue;
+			leds[index[i]] = ((int)(rgb[0]) << 16) + ((int)(rgb[1]) << 8) + ((int)(rgb[2]) << 0);
 		}
 	}
 }
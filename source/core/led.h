@@ -49,6 +49,12 @@ void led_fill(unsigned char red, unsigned char green, unsigned char blue);
 // Writes a color value to the LED Display buffer at the given position
 void led_write(int x, int y, unsigned char red, unsigned char green, unsigned char blue);
 
+// Gets the LED Display buffer position for a display position with mirroring and strip layout applied (-1 if not shown)
+int led_getIndex(int x, int y);
+
+// Writes count packed rgb values to the LED Display buffer at the given positions from led_getIndex (-1 skips a value)
+void led_writeIndexed(const unsigned char* rgb, const int* index, int count);
+
 // Gets the brightness of the LED Display [1-100]
 char led_getBrightness();
 
@@ -0,0 +1,184 @@
+#include "mtr.h"
+#include <math.h>
+
+#define MTR_BLOCK_RATE 100                 /* Number of meter blocks per second */
+#define MTR_RMS_BLOCKS 30                  /* Number of blocks in the rms window (300ms) */
+#define MTR_LOUDNESS_BLOCKS 300            /* Number of blocks in the short-term loudness window (3s) */
+#define MTR_LOUDNESS_OFFSET -0.691f        /* ITU-R BS.1770 loudness offset */
+
+// Filter state for one channel (two cascaded biquads)
+struct MTRFilterState {
+	double x1[2], x2[2];
+	double y1[2], y2[2];
+};
+
+// Data
+static unsigned int mtr_blockSize = 480;
+static double mtr_b[2][3];                                /* Biquad feed forward coefficients (shelf, high pass) */
+static double mtr_a[2][3];                                /* Biquad feedback coefficients (shelf, high pass) */
+static struct MTRFilterState mtr_filterLeft;
+static struct MTRFilterState mtr_filterRight;
+static unsigned int mtr_blockCount;
+static double mtr_blockSumLeft;
+static double mtr_blockSumRight;
+static double mtr_blockSumWeighted;
+static float mtr_historyLeft[MTR_LOUDNESS_BLOCKS];        /* Mean square of each block */
+static float mtr_historyRight[MTR_LOUDNESS_BLOCKS];
+static float mtr_historyWeighted[MTR_LOUDNESS_BLOCKS];    /* K-weighted mean square of each block (channels summed) */
+static unsigned int mtr_historyHead;
+static double mtr_windowLeft;
+static double mtr_windowRight;
+static double mtr_windowWeighted;
+
+// Published values (written by the sound thread, read by anyone)
+static float mtr_rmsLeft = 0;
+static float mtr_rmsRight = 0;
+static float mtr_loudness = MTR_LOUDNESS_FLOOR;
+
+// Helper Functions
+static double mtr_filter(struct MTRFilterState* state, double x);
+static void mtr_publish(float* value, float newValue);
+static float mtr_read(float* value);
+
+// Setup and initialize the Meter utils for the given sample rate
+int mtr_init(unsigned int sampleRate)
+{
+	//K-weighting (BS.1770 pre-filter shelf and rlb high pass) derived for any sample rate
+	double K = tan(M_PI*1681.974450955533/sampleRate);
+	double Q = 0.7071752369554196;
+	double Vh = pow(10.0, 3.999843853973347/20.0);
+	double Vb = pow(Vh, 0.4996667741545416);
+	double a0 = 1.0 + K/Q + K*K;
+	mtr_b[0][0] = (Vh + Vb*K/Q + K*K)/a0;
+	mtr_b[0][1] = 2.0*(K*K - Vh)/a0;
+	mtr_b[0][2] = (Vh - Vb*K/Q + K*K)/a0;
+	mtr_a[0][0] = 1.0;
+	mtr_a[0][1] = 2.0*(K*K - 1.0)/a0;
+	mtr_a[0][2] = (1.0 - K/Q + K*K)/a0;
+
+	K = tan(M_PI*38.13547087602444/sampleRate);
+	Q = 0.5003270373238773;
+	a0 = 1.0 + K/Q + K*K;
+	mtr_b[1][0] = 1.0;
+	mtr_b[1][1] = -2.0;
+	mtr_b[1][2] = 1.0;
+	mtr_a[1][0] = 1.0;
+	mtr_a[1][1] = 2.0*(K*K - 1.0)/a0;
+	mtr_a[1][2] = (1.0 - K/Q + K*K)/a0;
+
+	mtr_blockSize = sampleRate/MTR_BLOCK_RATE;
+	if(mtr_blockSize < 1) mtr_blockSize = 1;
+	mtr_reset();
+	return 0;
+}
+
+// Clears the meter history
+void mtr_reset()
+{
+	int i;
+	for(i=0; i<2; i++) {
+		mtr_filterLeft.x1[i] = mtr_filterLeft.x2[i] = mtr_filterLeft.y1[i] = mtr_filterLeft.y2[i] = 0;
+		mtr_filterRight.x1[i] = mtr_filterRight.x2[i] = mtr_filterRight.y1[i] = mtr_filterRight.y2[i] = 0;
+	}
+	for(i=0; i<MTR_LOUDNESS_BLOCKS; i++) {
+		mtr_historyLeft[i] = 0;
+		mtr_historyRight[i] = 0;
+		mtr_historyWeighted[i] = 0;
+	}
+	mtr_blockCount = 0;
+	mtr_blockSumLeft = 0;
+	mtr_blockSumRight = 0;
+	mtr_blockSumWeighted = 0;
+	mtr_historyHead = 0;
+	mtr_windowLeft = 0;
+	mtr_windowRight = 0;
+	mtr_windowWeighted = 0;
+
+	mtr_publish(&mtr_rmsLeft, 0);
+	mtr_publish(&mtr_rmsRight, 0);
+	mtr_publish(&mtr_loudness, MTR_LOUDNESS_FLOOR);
+}
+
+// Feeds interleaved stereo frames into the meters (called from the sound thread)
+void mtr_process(const signed short* buffer, unsigned int numFrames)
+{
+	int i;
+	for(i=0; i<numFrames; i++) {
+		double left = buffer[i*2 +0]/32768.0;
+		double right = buffer[i*2 +1]/32768.0;
+		double weightedLeft = mtr_filter(&mtr_filterLeft, left);
+		double weightedRight = mtr_filter(&mtr_filterRight, right);
+		mtr_blockSumLeft += left*left;
+		mtr_blockSumRight += right*right;
+		mtr_blockSumWeighted += weightedLeft*weightedLeft + weightedRight*weightedRight;
+		if(++mtr_blockCount < mtr_blockSize) continue;
+
+		//slide the windows by one block (running sums so each block costs the same)
+		unsigned int oldest = mtr_historyHead;
+		unsigned int rmsOldest = (mtr_historyHead + MTR_LOUDNESS_BLOCKS - MTR_RMS_BLOCKS)%MTR_LOUDNESS_BLOCKS;
+		float msLeft = mtr_blockSumLeft/mtr_blockSize;
+		float msRight = mtr_blockSumRight/mtr_blockSize;
+		float msWeighted = mtr_blockSumWeighted/mtr_blockSize;
+		mtr_windowLeft += msLeft - mtr_historyLeft[rmsOldest];
+		mtr_windowRight += msRight - mtr_historyRight[rmsOldest];
+		mtr_windowWeighted += msWeighted - mtr_historyWeighted[oldest];
+		mtr_historyLeft[mtr_historyHead] = msLeft;
+		mtr_historyRight[mtr_historyHead] = msRight;
+		mtr_historyWeighted[mtr_historyHead] = msWeighted;
+		mtr_historyHead = (mtr_historyHead + 1)%MTR_LOUDNESS_BLOCKS;
+		mtr_blockCount = 0;
+		mtr_blockSumLeft = 0;
+		mtr_blockSumRight = 0;
+		mtr_blockSumWeighted = 0;
+
+		//publish (clamped at zero since the running sums can drift slightly negative)
+		double rmsLeft = (mtr_windowLeft > 0) ? sqrt(mtr_windowLeft/MTR_RMS_BLOCKS) : 0;
+		double rmsRight = (mtr_windowRight > 0) ? sqrt(mtr_windowRight/MTR_RMS_BLOCKS) : 0;
+		double loudness = MTR_LOUDNESS_FLOOR;
+		if(mtr_windowWeighted > 0) loudness = MTR_LOUDNESS_OFFSET + 10.0*log10(mtr_windowWeighted/MTR_LOUDNESS_BLOCKS);
+		if(loudness < MTR_LOUDNESS_FLOOR) loudness = MTR_LOUDNESS_FLOOR;
+		mtr_publish(&mtr_rmsLeft, rmsLeft);
+		mtr_publish(&mtr_rmsRight, rmsRight);
+		mtr_publish(&mtr_loudness, loudness);
+	}
+}
+
+// Gets the left channel rms level over the last 300ms [0-1]
+float mtr_getRMSLeft()
+{
+	return mtr_read(&mtr_rmsLeft);
+}
+
+// Gets the right channel rms level over the last 300ms [0-1]
+float mtr_getRMSRight()
+{
+	return mtr_read(&mtr_rmsRight);
+}
+
+// Gets the K-weighted short-term loudness over the last 3s (LUFS)
+float mtr_getLoudness()
+{
+	return mtr_read(&mtr_loudness);
+}
+
+//helper functions
+static double mtr_filter(struct MTRFilterState* state, double x) {
+	int s;
+	for(s=0; s<2; s++) {
+		double y = mtr_b[s][0]*x + mtr_b[s][1]*state->x1[s] + mtr_b[s][2]*state->x2[s] - mtr_a[s][1]*state->y1[s] - mtr_a[s][2]*state->y2[s];
+		state->x2[s] = state->x1[s];
+		state->x1[s] = x;
+		state->y2[s] = state->y1[s];
+		state->y1[s] = y;
+		x = y;
+	}
+	return x;
+}
+static void mtr_publish(float* value, float newValue) {
+	__atomic_store(value, &newValue, __ATOMIC_RELEASE);
+}
+static float mtr_read(float* value) {
+	float result;
+	__atomic_load(value, &result, __ATOMIC_ACQUIRE);
+	return result;
+}
@@ -0,0 +1,24 @@
+#ifndef MTR_H
+#define MTR_H
+
+#define MTR_LOUDNESS_FLOOR -70.0f   /* Loudness reported for silence (LUFS) */
+
+// Setup and initialize the Meter utils for the given sample rate
+int mtr_init(unsigned int sampleRate);
+
+// Clears the meter history
+void mtr_reset();
+
+// Feeds interleaved stereo frames into the meters (called from the sound thread)
+void mtr_process(const signed short* buffer, unsigned int numFrames);
+
+// Gets the left channel rms level over the last 300ms [0-1]
+float mtr_getRMSLeft();
+
+// Gets the right channel rms level over the last 300ms [0-1]
+float mtr_getRMSRight();
+
+// Gets the K-weighted short-term loudness over the last 3s (LUFS)
+float mtr_getLoudness();
+
+#endif /* MTR_H */
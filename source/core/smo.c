@@ -0,0 +1,96 @@
+#include "smo.h"
+
+// Helper Functions
+static float smo_reflect(const float* in, int count, int index);
+static int smo_reflectFixed(const int* in, int count, int index);
+static int smo_toQ15(double value);
+
+// Builds the one sided kernel (center tap first) equal to the given number of 3-tap box passes, returns the number of taps
+int smo_buildKernel(int passes, float* kernel, int* kernelQ15)
+{
+	int k, n;
+	if(passes < 0) passes = 0;
+	if(passes > SMO_MAX_PASSES) passes = SMO_MAX_PASSES;
+
+	//N box passes equal one pass of the trinomial kernel (the box convolved with itself N times)
+	double taps[SMO_MAX_PASSES+2];
+	double prev[SMO_MAX_PASSES+2];
+	for(k=0; k<SMO_MAX_PASSES+2; k++) taps[k] = 0;
+	taps[0] = 1.0;
+	for(n=1; n<=passes; n++) {
+		for(k=0; k<=n+1; k++) prev[k] = taps[k];
+		for(k=0; k<=n; k++) taps[k] = (prev[(k > 0) ? k-1 : 1] + prev[k] + prev[k+1])/3.0;
+	}
+
+	//drop the tail taps that can't change the result (the kernel width only grows with sqrt(N))
+	int size = 1;
+	while(size <= passes && taps[size] >= SMO_KERNEL_EPSILON) size++;
+	for(k=0; k<size; k++) kernel[k] = taps[k];
+
+	//q15 taps come from the rounded tail sums so the kernel still sums to one (rounding each tap on its own adds up to a gain)
+	double tail = 0;
+	int tailQ15 = 0;
+	for(k=size-1; k>0; k--) {
+		tail += taps[k];
+		int rounded = smo_toQ15(tail);
+		kernelQ15[k] = rounded - tailQ15;
+		tailQ15 = rounded;
+	}
+	kernelQ15[0] = 32768 - 2*tailQ15;
+	return size;
+}
+
+// Smooths a frame of count values with the kernel in a single pass (same result as the zero padded box passes)
+void smo_smooth(const float* in, float* out, int count, const float* kernel, int size)
+{
+	int i, k;
+	int radius = size-1;
+	for(i=0; i<count; i++) {
+		float sum = in[i]*kernel[0];
+		if(i >= radius && i+radius < count) {
+			for(k=1; k<=radius; k++) sum += (in[i-k] + in[i+k])*kernel[k];
+		} else {
+			for(k=1; k<=radius; k++) sum += (smo_reflect(in, count, i-k) + smo_reflect(in, count, i+k))*kernel[k];
+		}
+		out[i] = sum;
+	}
+}
+
+// Smooths a frame of count values with the q15 kernel in a single pass (rounded and clamped at zero)
+void smo_smoothFixed(const int* in, int* out, int count, const int* kernelQ15, int size)
+{
+	int i, k;
+	int radius = size-1;
+	for(i=0; i<count; i++) {
+		int sum = in[i]*kernelQ15[0];
+		if(i >= radius && i+radius < count) {
+			for(k=1; k<=radius; k++) sum += (in[i-k] + in[i+k])*kernelQ15[k];
+		} else {
+			for(k=1; k<=radius; k++) sum += (smo_reflectFixed(in, count, i-k) + smo_reflectFixed(in, count, i+k))*kernelQ15[k];
+		}
+		sum = (sum + (1 << 14)) >> 15;
+		out[i] = (sum < 0) ? 0 : sum;
+	}
+}
+
+//helper functions
+static float smo_reflect(const float* in, int count, int index) {
+	//odd reflection around the values just outside the frame keeps them at zero, like the zero padding of the box passes
+	if(index < 0) index = -2 - index;
+	else if(index >= count) index = 2*count - index;
+	else return in[index];
+	if(index < 0 || index >= count) return 0;
+	return -in[index];
+}
+static int smo_reflectFixed(const int* in, int count, int index) {
+	if(index < 0) index = -2 - index;
+	else if(index >= count) index = 2*count - index;
+	else return in[index];
+	if(index < 0 || index >= count) return 0;
+	return -in[index];
+}
+static int smo_toQ15(double value) {
+	if(value >= 1.0) return 32768;
+	if(value <= -1.0) return -32768;
+	return (int)(value*32768.0 + ((value < 0) ? -0.5 : 0.5));
+}
@@ -0,0 +1,16 @@
+#ifndef SMO_H
+#define SMO_H
+
+#define SMO_MAX_PASSES 255          /* Most box passes a kernel can stand in for (kernels have up to SMO_MAX_PASSES+1 taps) */
+#define SMO_KERNEL_EPSILON 1e-7     /* Tail taps below this are dropped */
+
+// Builds the one sided kernel (center tap first) equal to the given number of 3-tap box passes, returns the number of taps
+int smo_buildKernel(int passes, float* kernel, int* kernelQ15);
+
+// Smooths a frame of count values with the kernel in a single pass (same result as the zero padded box passes)
+void smo_smooth(const float* in, float* out, int count, const float* kernel, int size);
+
+// Smooths a frame of count values with the q15 kernel in a single pass (rounded and clamped at zero)
+void smo_smoothFixed(const int* in, int* out, int count, const int* kernelQ15, int size);
+
+#endif /* SMO_H */
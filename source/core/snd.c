@@ -1,4 +1,6 @@
 #include "snd.h"
+#include "mtr.h"
+#include "fbk.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -26,6 +28,7 @@ static const char* snd_outputDeviceName;
 static unsigned char snd_volume;
 static signed short snd_sampleBuffer[MASTER_BUFFER_SEGMENTS*MASTER_BUFFER_PERIOD*DEVICE_PCM_CHANNELS];   /* The full buffer where all sound data is recorded */
 static signed short* snd_masterRingBuffer[MASTER_BUFFER_SEGMENTS];                                       /* Pointers to the full buffer to help denote sample order */
+static unsigned int snd_writeSequence = 0;                                                               /* Bumped after every write to the buffer (and when the thread stops) */
 
 //logic thread
 static char snd_processSoundThreadStatus = THREAD_STATUS_END;
@@ -52,6 +55,8 @@ int snd_init(const char* outputDevice)
 	snd_inputDeviceName = 0;
 	snd_outputDeviceName = 0;
 	
+	mtr_init(DEVICE_PCM_RATE);
+	fbk_init(DEVICE_PCM_RATE);
 	snd_setOutputDevice(outputDevice);
 	snd_setVolume(80);
 	return 0;
@@ -95,6 +100,12 @@ char snd_getIsRunning()
 
 // Fills the given buffer with data from the sound buffer
 void snd_collectSamples(signed short* buffer, unsigned int sampleRate, unsigned int numSamples)
+{
+	snd_collectSamplesBefore(buffer, sampleRate, numSamples, (numSamples/2)*(DEVICE_PCM_RATE/sampleRate));
+}
+
+// Fills the given buffer with data from the sound buffer, ending the given number of buffer frames before the newest one
+void snd_collectSamplesBefore(signed short* buffer, unsigned int sampleRate, unsigned int numSamples, unsigned int endOffset)
 {
 	int i;
 	if(snd_processSoundThreadStatus != THREAD_STATUS_RUNNING) {
@@ -108,7 +119,7 @@ void snd_collectSamples(signed short* buffer, unsigned int sampleRate, unsigned
 	for(i=0; i<MASTER_BUFFER_SEGMENTS; i++) ringBuffer[i] = snd_masterRingBuffer[i];
 	
 	//collect samples
-	int index = (MASTER_BUFFER_SEGMENTS*segmentSize) - (numSamples*skip*DEVICE_PCM_CHANNELS);
+	int index = (MASTER_BUFFER_SEGMENTS*segmentSize) - ((endOffset + (numSamples/2)*skip)*DEVICE_PCM_CHANNELS);
 	for(i=0; i<numSamples; i+=2) {
 		buffer[i] = snd_readRingBuffer(ringBuffer, MASTER_BUFFER_SEGMENTS, segmentSize, index);
 		if(DEVICE_PCM_CHANNELS == 2) buffer[i+1] = snd_readRingBuffer(ringBuffer, MASTER_BUFFER_SEGMENTS, segmentSize, index+1);
@@ -118,6 +129,12 @@ void snd_collectSamples(signed short* buffer, unsigned int sampleRate, unsigned
 	}
 }
 
+// Gets the sequence number of the last write to the sound buffer (changes whenever new samples can be collected)
+unsigned int snd_getWriteSequence()
+{
+	return __atomic_load_n(&snd_writeSequence, __ATOMIC_ACQUIRE);
+}
+
 // Plays the given sound file
 void snd_playFile(const char* filename)
 {
@@ -162,6 +179,7 @@ static void* snd_processSound(void* args)
 	int i, err;
 	if(!snd_inputDeviceName || !snd_outputDeviceName) {
 		snd_processSoundThreadStatus = THREAD_STATUS_END;
+		__atomic_add_fetch(&snd_writeSequence, 1, __ATOMIC_RELEASE);
 		return 0;
 	}
 	
@@ -172,12 +190,15 @@ static void* snd_processSound(void* args)
 		if(snd_inputHandle) snd_pcm_close(snd_inputHandle);
 		if(snd_outputHandle) snd_pcm_close(snd_outputHandle);
 		snd_processSoundThreadStatus = THREAD_STATUS_END;
+		__atomic_add_fetch(&snd_writeSequence, 1, __ATOMIC_RELEASE);
 		return 0;
 	}
 	
 	//setup data
 	for(i=0; i<MASTER_BUFFER_SEGMENTS*MASTER_BUFFER_PERIOD*DEVICE_PCM_CHANNELS; i++) snd_sampleBuffer[i] = 0;
 	for(i=0; i<MASTER_BUFFER_SEGMENTS; i++) snd_masterRingBuffer[i] = &(snd_sampleBuffer[i*MASTER_BUFFER_PERIOD*DEVICE_PCM_CHANNELS]);
+	mtr_reset();
+	fbk_reset();
 	
 	//start by giving the output buffer a head start
 	snd_writePCM(snd_outputHandle, snd_masterRingBuffer[0], MASTER_BUFFER_PERIOD);
@@ -193,6 +214,9 @@ static void* snd_processSound(void* args)
 		
 		err = snd_readPCM(snd_inputHandle, buffer, MASTER_BUFFER_PERIOD);
 		if(err < 0) break;
+		mtr_process(buffer, err);
+		fbk_process(buffer, err);
+		__atomic_add_fetch(&snd_writeSequence, 1, __ATOMIC_RELEASE);
 		
 		if(snd_processSoundThreadStatus) break;
 		
@@ -203,7 +227,10 @@ static void* snd_processSound(void* args)
 	//cleanup and exit
 	snd_pcm_close(snd_inputHandle);
 	snd_pcm_close(snd_outputHandle);
+	mtr_reset();
+	fbk_reset();
 	snd_processSoundThreadStatus = THREAD_STATUS_END;
+	__atomic_add_fetch(&snd_writeSequence, 1, __ATOMIC_RELEASE);
 	return 0;
 }
 void snd_startSoundThread()
@@ -22,6 +22,12 @@ char snd_getIsRunning();
 // Fills the given buffer with data from the sound buffer
 void snd_collectSamples(signed short* buffer, unsigned int sampleRate, unsigned int numSamples);
 
+// Fills the given buffer with data from the sound buffer, ending the given number of buffer frames before the newest one
+void snd_collectSamplesBefore(signed short* buffer, unsigned int sampleRate, unsigned int numSamples, unsigned int endOffset);
+
+// Gets the sequence number of the last write to the sound buffer (changes whenever new samples can be collected)
+unsigned int snd_getWriteSequence();
+
 // Plays the given sound file
 void snd_playFile(const char* filename);
 
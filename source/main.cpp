@@ -40,6 +40,8 @@
 #define DEFAULT_VISUALIZER_RANDOMIZER 0
 #define DEFAULT_VISUALIZER_RANDOMIZER_TIME 0
 
+#define DEFAULT_SOUND_FIXED_POINT 0
+
 #define DEFAULT_VIDEO_SIZE_X 32
 #define DEFAULT_VIDEO_SIZE_Y 16
 #define DEFAULT_VIDEO_OVERSAMPLE 1
@@ -236,15 +238,16 @@ int main(int argc, char** argv)
 			}
 		}
 		
-		//run sound analysis
-		soundAnalyzer->refresh();
-		
 		//update time
 		double time = core_getTime();
 		double elapsedTime = time - lastTick;
 		lastTick = time;
 		//printf("Time elpased is %f seconds\n", elapsedTime);/////////////////////////////////////////////////////////////////////////////
 		
+		//run sound analysis (only the stages the current visualizer uses)
+		soundAnalyzer->setFeatures(visualizers[visualizer]->getFeatures());
+		soundAnalyzer->refresh(elapsedTime);
+		
 		//render
 		visualizers[visualizer]->draw(elapsedTime);
 		if(editMode==1) core_drawEditMode();
@@ -270,6 +273,7 @@ void core_initSettings() {
 	snd_setVolume(settingsManager->getPropertyInteger("system.volume", 80));
 	led_setBrightness(settingsManager->getPropertyInteger("system.brightness", 80));
 	inp_setButtonHold(INP_BTN_PWR, (~settingsManager->getPropertyInteger("system.poweroff.hold", 1)) & 0x01);
+	soundAnalyzer->setFixedPoint(settingsManager->getPropertyInteger("sound.system.fixed_point", DEFAULT_SOUND_FIXED_POINT) > 0);
 	
 	defaultVisualizer = settingsManager->getPropertyInteger("visualizer.default.index", DEFAULT_VISUALIZER_INDEX);
 	defaultStyle = settingsManager->getPropertyInteger("visualizer.default.style", DEFAULT_VISUALIZER_STYLE);
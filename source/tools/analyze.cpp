@@ -0,0 +1,367 @@
+//-----------------------------------------------------------------------------------------
+// Title:   Offline Sound Analysis
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "wav.h"
+#include "CSoundAnalyzer.h"
+
+#define DEFAULT_FRAME_RATE 60.0
+#define DEFAULT_SECTIONS "wsbltc"
+#define DEFAULT_TOLERANCE 0.0
+
+#define COMPARE_MAX_REPORT 16
+
+//functions
+int analyze(const char* inputFile, const char* outputFile, double frameRate, const char* sections, CSoundAnalyzer* soundAnalyzer);
+int compare(const char* fileA, const char* fileB, double tolerance, double relative, double peak);
+int parseSections(const char* sections);
+bool parseTimeConstants(const char* arg, CSoundAnalyzer* soundAnalyzer);
+void writeHeader(FILE* file, int features, CSoundAnalyzer* soundAnalyzer);
+void writeRow(FILE* file, int features, double time, CSoundAnalyzer* soundAnalyzer);
+int splitRow(char* line, char** cells, int maxCells);
+double getTime();
+void printUsage();
+
+//main
+int main(int argc, char** argv)
+{
+	double frameRate = DEFAULT_FRAME_RATE;
+	double tolerance = DEFAULT_TOLERANCE;
+	double relative = 0;
+	double peak = 0;
+	const char* sections = DEFAULT_SECTIONS;
+	bool compareMode = false;
+	int layout = SND_DEFAULT_BAND_LAYOUT;
+	int numBands = SND_DEFAULT_NUM_BANDS;
+	CSoundAnalyzer* soundAnalyzer = new CSoundAnalyzer();
+
+	int opt;
+	while((opt = getopt(argc, argv, "r:s:b:l:p:e:g:d:t:f:axmch")) != -1) {
+		switch(opt) {
+			case 'r': frameRate = atof(optarg); break;
+			case 's': sections = optarg; break;
+			case 'b': numBands = atoi(optarg); break;
+			case 'l': layout = atoi(optarg); break;
+			case 'p': soundAnalyzer->setSpecSmoothPass(atoi(optarg)); break;
+			case 'g': soundAnalyzer->setAGCTarget(atof(optarg)); break;
+			case 'a': soundAnalyzer->setAGC(false); break;
+			case 'x': soundAnalyzer->setFixedPoint(true); break;
+			case 'm': soundAnalyzer->setMultiResolution(true); break;
+			case 'd': tolerance = atof(optarg); break;
+			case 't': relative = atof(optarg); break;
+			case 'f': peak = atof(optarg); break;
+			case 'c': compareMode = true; break;
+			case 'e':
+				if(!parseTimeConstants(optarg, soundAnalyzer)) {
+					fprintf(stderr, "Invalid time constants: %s\n", optarg);
+					return 2;
+				}
+				break;
+			default: printUsage(); return 2;
+		}
+	}
+	if(argc - optind != 2 || frameRate <= 0 || parseSections(sections) < 0) {
+		printUsage();
+		return 2;
+	}
+	soundAnalyzer->setBandLayout(layout, numBands);
+
+	int result;
+	if(compareMode) result = compare(argv[optind], argv[optind+1], tolerance, relative, peak);
+	else result = analyze(argv[optind], argv[optind+1], frameRate, sections, soundAnalyzer);
+	delete soundAnalyzer;
+	return result;
+}
+
+//runs the analyzer over a wav file at a fixed frame rate and writes the timeline as csv
+int analyze(const char* inputFile, const char* outputFile, double frameRate, const char* sections, CSoundAnalyzer* soundAnalyzer)
+{
+	if(wav_open(inputFile)) return 2;
+	FILE* file = strcmp(outputFile, "-") ? fopen(outputFile, "w") : stdout;
+	if(!file) {
+		fprintf(stderr, "Failed to open output file: %s\n", outputFile);
+		wav_close();
+		return 2;
+	}
+
+	int features = parseSections(sections);
+	soundAnalyzer->setFeatures(features);
+	writeHeader(file, features, soundAnalyzer);
+
+	//step through the file as fast as possible (the analyzer only sees the fixed frame time)
+	double startTime = getTime();
+	double frameTime = 1.0/frameRate;
+	int frame = 0;
+	while(wav_advance(frameTime)) {
+		frame++;
+		soundAnalyzer->refresh(frameTime);
+		writeRow(file, features, frame*frameTime, soundAnalyzer);
+	}
+	double runTime = getTime() - startTime;
+
+	if(file != stdout) fclose(file);
+	fprintf(stderr, "Analyzed %.1fs of audio in %d frames (%.3fs, %.0fx real time, %u redundant refreshes)\n",
+		wav_getDuration(), frame, runTime, (runTime > 0) ? wav_getDuration()/runTime : 0.0, soundAnalyzer->getRedundantRefreshes());
+	wav_close();
+	return 0;
+}
+
+//diffs two timelines cell by cell and reports the columns that differ by more than the tolerance
+//(absolute, plus a fraction of the first timeline's value and of the row's peak over the columns with the same name before the index)
+int compare(const char* fileA, const char* fileB, double tolerance, double relative, double peak)
+{
+	FILE* a = fopen(fileA, "r");
+	FILE* b = fopen(fileB, "r");
+	if(!a || !b) {
+		fprintf(stderr, "Failed to open timeline: %s\n", a ? fileB : fileA);
+		if(a) fclose(a);
+		if(b) fclose(b);
+		return 2;
+	}
+
+	//headers must match exactly
+	char* lineA = 0;
+	char* lineB = 0;
+	size_t sizeA = 0;
+	size_t sizeB = 0;
+	if(getline(&lineA, &sizeA, a) < 0 || getline(&lineB, &sizeB, b) < 0 || strcmp(lineA, lineB)) {
+		fprintf(stderr, "Timelines have different columns (compare runs with the same sections and bands)\n");
+		free(lineA);
+		free(lineB);
+		fclose(a);
+		fclose(b);
+		return 2;
+	}
+	int numColumns = 1;
+	for(char* c=lineA; *c; c++) if(*c == ',') numColumns++;
+	char** names = new char*[numColumns];
+	char* header = strdup(lineA);
+	splitRow(header, names, numColumns);
+	
+	//columns sharing a name before the index are next to each other (specL0, specL1, ...)
+	int* groups = new int[numColumns];
+	int numGroups = 0;
+	for(int i=0; i<numColumns; i++) {
+		size_t stem = strcspn(names[i], "0123456789");
+		if(i == 0 || stem != strcspn(names[i-1], "0123456789") || strncmp(names[i], names[i-1], stem)) numGroups++;
+		groups[i] = numGroups-1;
+	}
+	double* groupPeak = new double[numGroups];
+	double* valuesA = new double[numColumns];
+
+	char** cellsA = new char*[numColumns];
+	char** cellsB = new char*[numColumns];
+	double* maxDiff = new double[numColumns];
+	int* failCount = new int[numColumns];
+	double* firstFail = new double[numColumns];
+	for(int i=0; i<numColumns; i++) {
+		maxDiff[i] = 0;
+		failCount[i] = 0;
+		firstFail[i] = 0;
+	}
+
+	//compare rows until either timeline ends
+	int rows = 0;
+	bool lengthMismatch = false;
+	while(1==1) {
+		bool hasA = getline(&lineA, &sizeA, a) >= 0;
+		bool hasB = getline(&lineB, &sizeB, b) >= 0;
+		if(hasA != hasB) lengthMismatch = true;
+		if(!hasA || !hasB) break;
+
+		int countA = splitRow(lineA, cellsA, numColumns);
+		int countB = splitRow(lineB, cellsB, numColumns);
+		if(countA != numColumns || countB != numColumns) {
+			fprintf(stderr, "Malformed row %d\n", rows+1);
+			lengthMismatch = true;
+			break;
+		}
+		double time = atof(cellsA[0]);
+		for(int g=0; g<numGroups; g++) groupPeak[g] = 0;
+		for(int i=0; i<numColumns; i++) {
+			valuesA[i] = atof(cellsA[i]);
+			if(fabs(valuesA[i]) > groupPeak[groups[i]]) groupPeak[groups[i]] = fabs(valuesA[i]);
+		}
+		for(int i=0; i<numColumns; i++) {
+			double diff = fabs(valuesA[i] - atof(cellsB[i]));
+			if(diff > maxDiff[i]) maxDiff[i] = diff;
+			double bound = tolerance + relative*fabs(valuesA[i]) + peak*groupPeak[groups[i]];
+			if(diff > bound && failCount[i]++ == 0) firstFail[i] = time;
+		}
+		rows++;
+	}
+
+	//report
+	int failColumns = 0;
+	for(int i=0; i<numColumns; i++) {
+		if(!failCount[i]) continue;
+		if(failColumns++ < COMPARE_MAX_REPORT) {
+			printf("%-12s %6d rows over tolerance, max diff %g, first at %.4fs\n", names[i], failCount[i], maxDiff[i], firstFail[i]);
+		}
+	}
+	if(failColumns > COMPARE_MAX_REPORT) printf("... and %d more columns\n", failColumns - COMPARE_MAX_REPORT);
+	if(lengthMismatch) printf("Timelines have a different number of rows (compared %d)\n", rows);
+	printf("%s: %d rows, %d columns, %d over tolerance %g (+%g of value, +%g of peak)\n", (failColumns || lengthMismatch) ? "FAIL" : "PASS", rows, numColumns, failColumns, tolerance, relative, peak);
+
+	free(lineA);
+	free(lineB);
+	free(header);
+	delete[] names;
+	delete[] groups;
+	delete[] groupPeak;
+	delete[] valuesA;
+	delete[] cellsA;
+	delete[] cellsB;
+	delete[] maxDiff;
+	delete[] failCount;
+	delete[] firstFail;
+	fclose(a);
+	fclose(b);
+	return (failColumns || lengthMismatch) ? 1 : 0;
+}
+
+//maps section letters onto analyzer features (-1 if invalid)
+int parseSections(const char* sections)
+{
+	int features = 0;
+	for(const char* c=sections; *c; c++) {
+		switch(*c) {
+			case 'w': features |= SND_FEATURE_WAVE_LEFT | SND_FEATURE_WAVE_RIGHT; break;
+			case 's': features |= SND_FEATURE_SPEC; break;
+			case 'b': features |= SND_FEATURE_BANDS; break;
+			case 'l': features |= SND_FEATURE_LEVELS; break;
+			case 't': features |= SND_FEATURE_BEAT; break;
+			case 'c': features |= SND_FEATURE_CHROMA; break;
+			default: return -1;
+		}
+	}
+	return features;
+}
+
+//parses time constants of the form <wave|spec|band|vu|agc>:<attack>,<release>
+bool parseTimeConstants(const char* arg, CSoundAnalyzer* soundAnalyzer)
+{
+	char name[8];
+	float attack, release;
+	if(sscanf(arg, "%7[^:]:%f,%f", name, &attack, &release) != 3) return false;
+	if(!strcmp(name, "wave")) soundAnalyzer->setWaveTimeConstants(attack, release);
+	else if(!strcmp(name, "spec")) soundAnalyzer->setSpecTimeConstants(attack, release);
+	else if(!strcmp(name, "band")) soundAnalyzer->setBandTimeConstants(attack, release);
+	else if(!strcmp(name, "vu")) soundAnalyzer->setVUTimeConstants(attack, release);
+	else if(!strcmp(name, "agc")) soundAnalyzer->setAGCTimeConstants(attack, release);
+	else return false;
+	return true;
+}
+
+//writes the column names
+void writeHeader(FILE* file, int features, CSoundAnalyzer* soundAnalyzer)
+{
+	fprintf(file, "time");
+	if(features & SND_FEATURE_BEAT) fprintf(file, ",onset,beat,phase,bpm");
+	if(features & SND_FEATURE_LEVELS) {
+		fprintf(file, ",vuL,vuR,bassL,bassR,midL,midR,trebL,trebR,rmsL,rmsR,loudness,gain,sub,kick,snare,hats");
+	}
+	if(features & SND_FEATURE_BANDS) {
+		for(int i=0; i<soundAnalyzer->getNumBands(); i++) fprintf(file, ",bandL%d", i);
+		for(int i=0; i<soundAnalyzer->getNumBands(); i++) fprintf(file, ",bandR%d", i);
+	}
+	if(features & SND_FEATURE_CHROMA) {
+		for(int i=0; i<CQ_BINS_PER_OCTAVE; i++) fprintf(file, ",chroma%d", i);
+	}
+	if(features & SND_FEATURE_SPEC) {
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/2; i++) fprintf(file, ",specL%d", i);
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/2; i++) fprintf(file, ",specR%d", i);
+	}
+	if(features & SND_FEATURE_WAVE_LEFT) {
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) fprintf(file, ",waveL%d", i);
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) fprintf(file, ",waveR%d", i);
+	}
+	fprintf(file, "\n");
+}
+
+//writes the analyzer outputs for one frame
+void writeRow(FILE* file, int features, double time, CSoundAnalyzer* soundAnalyzer)
+{
+	fprintf(file, "%.4f", time);
+	if(features & SND_FEATURE_BEAT) {
+		fprintf(file, ",%d,%d,%.3f,%.2f", soundAnalyzer->getOnset(), soundAnalyzer->getBeat(), soundAnalyzer->getBeatPhase(), soundAnalyzer->getBpm());
+	}
+	if(features & SND_FEATURE_LEVELS) {
+		fprintf(file, ",%d,%d,%d,%d,%d,%d,%d,%d,%.4f,%.4f,%.2f,%.3f",
+			soundAnalyzer->getVULeft(), soundAnalyzer->getVURight(), soundAnalyzer->getBassLeft(), soundAnalyzer->getBassRight(),
+			soundAnalyzer->getMidLeft(), soundAnalyzer->getMidRight(), soundAnalyzer->getTrebLeft(), soundAnalyzer->getTrebRight(),
+			soundAnalyzer->getRMSLeft(), soundAnalyzer->getRMSRight(), soundAnalyzer->getLoudness(), soundAnalyzer->getAGCGain());
+		for(int i=0; i<FBK_NUM_BANDS; i++) fprintf(file, ",%.4f", soundAnalyzer->getEnvelope(i));
+	}
+	if(features & SND_FEATURE_BANDS) {
+		for(int i=0; i<soundAnalyzer->getNumBands(); i++) fprintf(file, ",%d", soundAnalyzer->getBandLeft(i));
+		for(int i=0; i<soundAnalyzer->getNumBands(); i++) fprintf(file, ",%d", soundAnalyzer->getBandRight(i));
+	}
+	if(features & SND_FEATURE_CHROMA) {
+		for(int i=0; i<CQ_BINS_PER_OCTAVE; i++) fprintf(file, ",%.3f", soundAnalyzer->getChroma(i));
+	}
+	if(features & SND_FEATURE_SPEC) {
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/2; i++) fprintf(file, ",%d", soundAnalyzer->getSpecLeft(i));
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE/2; i++) fprintf(file, ",%d", soundAnalyzer->getSpecRight(i));
+	}
+	if(features & SND_FEATURE_WAVE_LEFT) {
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) fprintf(file, ",%d", soundAnalyzer->getWaveLeft(i));
+		for(int i=0; i<SND_BUFFER_SAMPLE_SIZE; i++) fprintf(file, ",%d", soundAnalyzer->getWaveRight(i));
+	}
+	fprintf(file, "\n");
+}
+
+//splits a csv row in place (returns the number of cells)
+int splitRow(char* line, char** cells, int maxCells)
+{
+	int count = 0;
+	char* cell = line;
+	while(count < maxCells) {
+		cells[count++] = cell;
+		char* comma = strchr(cell, ',');
+		if(!comma) break;
+		*comma = 0;
+		cell = comma+1;
+	}
+	if(count > 0) cells[count-1][strcspn(cells[count-1], "\r\n")] = 0;
+	return count;
+}
+
+//gets the time in seconds
+double getTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + (tv.tv_usec/1000000.0);
+}
+
+//prints the usage
+void printUsage()
+{
+	fprintf(stderr,
+		"usage: visualsound-analyze [options] <input.wav> <output.csv|->\n"
+		"       visualsound-analyze -c [-d tolerance] [-t relative] [-f peak] <a.csv> <b.csv>\n"
+		"options:\n"
+		"  -r <fps>          refresh rate to analyze at (default %.0f)\n"
+		"  -s <sections>     timeline sections: w(ave) s(pectrum) b(ands) l(evels) t(empo/beat) c(hroma) (default %s)\n"
+		"  -b <bands>        number of bands (default %d)\n"
+		"  -l <layout>       band layout: 0 linear, 1 log, 2 mel, 3 third octave (default %d)\n"
+		"  -p <passes>       spectrum smoothing passes\n"
+		"  -e <name:a,r>     attack/release time constants for wave, spec, band, vu or agc\n"
+		"  -g <lufs>         automatic gain target\n"
+		"  -a                disable automatic gain\n"
+		"  -x                use the fixed point analysis path\n"
+		"  -m                use multi-resolution bands (short window above the crossover)\n"
+		"  -c                compare two timelines (exit status 1 if any cell differs by more than the tolerance)\n"
+		"  -d <tolerance>    absolute tolerance for compare (default %g)\n"
+		"  -t <fraction>     add a fraction of the value in a.csv to the compare tolerance\n"
+		"  -f <fraction>     add a fraction of the row's peak in the same named columns (specL, bandR, ...) to the compare tolerance\n",
+		DEFAULT_FRAME_RATE, DEFAULT_SECTIONS, SND_DEFAULT_NUM_BANDS, SND_DEFAULT_BAND_LAYOUT, DEFAULT_TOLERANCE);
+}
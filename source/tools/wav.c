@@ -0,0 +1,256 @@
+#include "wav.h"
+#include "snd.h"
+#include "mtr.h"
+#include "fbk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WAV_PCM_RATE 48000       /* Sample rate the file is resampled to (matches the sound device) */
+#define WAV_PCM_CHANNELS 2       /* Number of channels the file is converted to */
+#define WAV_PCM_PERIOD 600       /* The number of samples written per sound buffer period (matches the sound device) */
+
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+// Data
+static signed short* wav_samples = 0;             /* Interleaved stereo samples at the device rate */
+static unsigned int wav_numFrames = 0;
+static double wav_time = 0;
+static unsigned int wav_numPeriods = 0;           /* Number of periods written to the (virtual) sound buffer so far */
+static unsigned int wav_writeSequence = 0;
+static unsigned char wav_volume = 80;
+
+// Helper Functions
+static unsigned int wav_readU32(const unsigned char* data);
+static unsigned short wav_readU16(const unsigned char* data);
+static signed short wav_getSample(unsigned int frame, unsigned int channel);
+
+// Opens a 16-bit pcm wav file as the sound source (replaces the Sound utils for offline use)
+int wav_open(const char* filename)
+{
+	unsigned char header[12];
+	unsigned char chunk[8];
+	unsigned char format[16];
+	unsigned int i;
+	wav_close();
+
+	FILE* file = fopen(filename, "rb");
+	if(!file) {
+		printf("[WAV] Failed to open file: %s\n", filename);
+		return 1;
+	}
+	if(fread(header, 1, 12, file) != 12 || memcmp(header, "RIFF", 4) || memcmp(header+8, "WAVE", 4)) {
+		printf("[WAV] Not a wav file: %s\n", filename);
+		fclose(file);
+		return 1;
+	}
+
+	//walk the chunks for the format and data
+	unsigned int channels = 0;
+	unsigned int rate = 0;
+	signed short* data = 0;
+	unsigned int dataFrames = 0;
+	while(fread(chunk, 1, 8, file) == 8) {
+		unsigned int size = wav_readU32(chunk+4);
+		if(!memcmp(chunk, "fmt ", 4) && size >= 16) {
+			if(fread(format, 1, 16, file) != 16) break;
+			unsigned short type = wav_readU16(format);
+			channels = wav_readU16(format+2);
+			rate = wav_readU32(format+4);
+			unsigned short bits = wav_readU16(format+14);
+			if((type != WAV_FORMAT_PCM && type != WAV_FORMAT_EXTENSIBLE) || bits != 16 || channels < 1 || channels > 2 || rate == 0) {
+				printf("[WAV] Unsupported format (only 16-bit pcm mono or stereo): %s\n", filename);
+				fclose(file);
+				return 1;
+			}
+			fseek(file, size - 16 + (size&1), SEEK_CUR);
+		} else if(!memcmp(chunk, "data", 4) && channels) {
+			unsigned char* raw = (unsigned char*)malloc(size);
+			size = fread(raw, 1, size, file);
+			dataFrames = size/(2*channels);
+			data = (signed short*)malloc(dataFrames*channels*sizeof(signed short));
+			for(i=0; i<dataFrames*channels; i++) data[i] = (signed short)wav_readU16(raw + i*2);
+			free(raw);
+			break;
+		} else {
+			fseek(file, size + (size&1), SEEK_CUR);
+		}
+	}
+	fclose(file);
+	if(!data) {
+		printf("[WAV] Missing format or data chunk: %s\n", filename);
+		return 1;
+	}
+
+	//convert to stereo at the device rate (linear interpolation when the rates differ)
+	wav_numFrames = (unsigned int)(((unsigned long long)dataFrames*WAV_PCM_RATE)/rate);
+	wav_samples = (signed short*)malloc((wav_numFrames+1)*WAV_PCM_CHANNELS*sizeof(signed short));
+	for(i=0; i<wav_numFrames; i++) {
+		unsigned long long position = ((unsigned long long)i*rate*65536)/WAV_PCM_RATE;
+		unsigned int frame = position>>16;
+		int fraction = position&0xFFFF;
+		unsigned int next = (frame+1 < dataFrames) ? frame+1 : frame;
+		int c;
+		for(c=0; c<WAV_PCM_CHANNELS; c++) {
+			int channel = (channels == 2) ? c : 0;
+			int a = data[frame*channels + channel];
+			int b = data[next*channels + channel];
+			wav_samples[i*WAV_PCM_CHANNELS + c] = a + (((b - a)*fraction)>>16);
+		}
+	}
+	free(data);
+
+	wav_time = 0;
+	wav_numPeriods = 0;
+	mtr_init(WAV_PCM_RATE);
+	fbk_init(WAV_PCM_RATE);
+	return 0;
+}
+
+// Gets the length of the open file in seconds
+double wav_getDuration()
+{
+	return (double)wav_numFrames/WAV_PCM_RATE;
+}
+
+// Advances playback by the given time in seconds (returns 0 once the end of the file is reached)
+char wav_advance(double elapsedTime)
+{
+	if(!wav_samples) return 0;
+	wav_time += elapsedTime;
+
+	//write every period that has fully played by now (like the sound thread does)
+	unsigned int numPeriods = (unsigned int)((wav_time*WAV_PCM_RATE)/WAV_PCM_PERIOD);
+	while(wav_numPeriods < numPeriods) {
+		signed short period[WAV_PCM_PERIOD*WAV_PCM_CHANNELS];
+		unsigned int start = wav_numPeriods*WAV_PCM_PERIOD;
+		unsigned int i;
+		for(i=0; i<WAV_PCM_PERIOD; i++) {
+			period[i*2 +0] = wav_getSample(start+i, 0);
+			period[i*2 +1] = wav_getSample(start+i, 1);
+		}
+		mtr_process(period, WAV_PCM_PERIOD);
+		fbk_process(period, WAV_PCM_PERIOD);
+		wav_numPeriods++;
+		wav_writeSequence++;
+	}
+	return (wav_time < wav_getDuration()) ? 1 : 0;
+}
+
+// Closes the open file
+void wav_close()
+{
+	if(wav_samples) free(wav_samples);
+	wav_samples = 0;
+	wav_numFrames = 0;
+	wav_time = 0;
+	wav_numPeriods = 0;
+	wav_writeSequence++;
+}
+
+// Setup and initialize the Sound utils
+int snd_init(const char* outputDevice)
+{
+	mtr_init(WAV_PCM_RATE);
+	fbk_init(WAV_PCM_RATE);
+	return 0;
+}
+
+// Checks if the Sound utils are initialized
+char snd_isInit()
+{
+	return 1;
+}
+
+// Sets the input device
+void snd_setInputDevice(const char* inputDevice)
+{
+}
+
+// Sets the output device
+void snd_setOutputDevice(const char* outputDevice)
+{
+}
+
+// Gets the rate of the sound buffer
+unsigned int snd_getBufferRate()
+{
+	return WAV_PCM_RATE;
+}
+
+// Gets if the sound is running
+char snd_getIsRunning()
+{
+	if(wav_samples) return 1;
+	return 0;
+}
+
+// Fills the given buffer with data from the sound buffer
+void snd_collectSamples(signed short* buffer, unsigned int sampleRate, unsigned int numSamples)
+{
+	snd_collectSamplesBefore(buffer, sampleRate, numSamples, (numSamples/2)*(WAV_PCM_RATE/sampleRate));
+}
+
+// Fills the given buffer with data from the sound buffer, ending the given number of buffer frames before the newest one
+void snd_collectSamplesBefore(signed short* buffer, unsigned int sampleRate, unsigned int numSamples, unsigned int endOffset)
+{
+	int i;
+	if(!wav_samples) {
+		for(i=0; i<numSamples; i++) buffer[i] = 0;
+		return;
+	}
+
+	//same window and decimation as the sound device buffer (ending at the last written period)
+	int skip = (WAV_PCM_RATE/sampleRate);
+	long long frame = (long long)wav_numPeriods*WAV_PCM_PERIOD - endOffset - (long long)(numSamples/2)*skip;
+	for(i=0; i<numSamples; i+=2) {
+		buffer[i] = (frame >= 0) ? wav_getSample(frame, 0) : 0;
+		buffer[i+1] = (frame >= 0) ? wav_getSample(frame, 1) : 0;
+		frame += skip;
+	}
+}
+
+// Gets the sequence number of the last write to the sound buffer (changes whenever new samples can be collected)
+unsigned int snd_getWriteSequence()
+{
+	return wav_writeSequence;
+}
+
+// Plays the given sound file
+void snd_playFile(const char* filename)
+{
+}
+
+// Sets the system volume [0-100]
+void snd_setVolume(char volume)
+{
+	if(volume > 100) volume = 100;
+	if(volume < 0) volume = 0;
+	wav_volume = volume;
+}
+
+// Gets the system volume [0-100]
+unsigned char snd_getVolume()
+{
+	return wav_volume;
+}
+
+// Cleans up the Sound utils
+int snd_close()
+{
+	wav_close();
+	return 0;
+}
+
+//helper functions
+static unsigned int wav_readU32(const unsigned char* data) {
+	return data[0] | (data[1]<<8) | (data[2]<<16) | ((unsigned int)data[3]<<24);
+}
+static unsigned short wav_readU16(const unsigned char* data) {
+	return data[0] | (data[1]<<8);
+}
+static signed short wav_getSample(unsigned int frame, unsigned int channel) {
+	if(frame >= wav_numFrames) return 0;
+	return wav_samples[frame*WAV_PCM_CHANNELS + channel];
+}
@@ -0,0 +1,16 @@
+#ifndef WAV_H
+#define WAV_H
+
+// Opens a 16-bit pcm wav file as the sound source (replaces the Sound utils for offline use)
+int wav_open(const char* filename);
+
+// Gets the length of the open file in seconds
+double wav_getDuration();
+
+// Advances playback by the given time in seconds (returns 0 once the end of the file is reached)
+char wav_advance(double elapsedTime);
+
+// Closes the open file
+void wav_close();
+
+#endif /* WAV_H */
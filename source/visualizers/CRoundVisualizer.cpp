@@ -15,6 +15,13 @@
 #define STYLE_JUST_SPEC 3
 #define NUM_STYLES 4
 
+#define SPEC_POINTS 100
+#define WAVE_MAX_POINTS 1024
+
+//time constants of the old per frame smoothing at 60fps, -(1/60)/ln(1-factor) (wave 0.6, spectrum 0.3 also carried by bands and volume)
+#define WAVE_TIME_CONSTANT 0.018f
+#define SPEC_TIME_CONSTANT 0.047f
+
 //! Main Constructor
 CRoundVisualizer::CRoundVisualizer(CVideoDriver* vd, CSoundAnalyzer* sa, int r) :
 	videoDriver(vd), soundAnalyzer(sa), color1(0,0,0), color2(0,0,0), style(0), rotation(r), accRotate(0)
@@ -33,17 +40,23 @@ void CRoundVisualizer::setup()
 	videoDriver->setRotation(rotation);
 	soundAnalyzer->setSamplingFrequency(SND_DEFAULT_SAMPLE_FREQUENCY);
 	soundAnalyzer->setWaveLPF(0.3f);
-	soundAnalyzer->setWaveTimeSmooth(0.6f);
 	soundAnalyzer->setSpecSmoothPass(8);
-	soundAnalyzer->setSpecTimeSmooth(0.3f);
+	soundAnalyzer->setWaveTimeConstants(WAVE_TIME_CONSTANT, WAVE_TIME_CONSTANT);
+	soundAnalyzer->setSpecTimeConstants(SPEC_TIME_CONSTANT, SPEC_TIME_CONSTANT);
+	soundAnalyzer->setBandTimeConstants(SPEC_TIME_CONSTANT, SPEC_TIME_CONSTANT);
+	soundAnalyzer->setVUTimeConstants(SPEC_TIME_CONSTANT, SPEC_TIME_CONSTANT);
+	soundAnalyzer->setAGC(true);
+	soundAnalyzer->setAGCTarget(-23.0f);
+	soundAnalyzer->setAGCTimeConstants(0.5f, 5.0f);
+	soundAnalyzer->setBandLayout(BAND_LAYOUT_LOG, SPEC_POINTS);
 }
 
 //! Draws the visualizer
 void CRoundVisualizer::draw(double elapsedTime)
 {
 	//compute basic values
-	float intensity = (float)(soundAnalyzer->getVURight()+soundAnalyzer->getVULeft())/6000.0f;
-	float bassIntensity = (float)(soundAnalyzer->getBassRight()+soundAnalyzer->getBassLeft())/24000.0f;
+	float intensity = (soundAnalyzer->getVURightNorm()+soundAnalyzer->getVULeftNorm())/2.0f;
+	float bassIntensity = (soundAnalyzer->getBassRightNorm()+soundAnalyzer->getBassLeftNorm())/2.0f;
 	float cappedIntensity = (intensity > 1.0f) ? 1.0f : intensity;
 	int videoOversample = videoDriver->getOversample();
 	int videoDimX = videoDriver->getDimension().X;
@@ -71,68 +84,64 @@ void CRoundVisualizer::draw(double elapsedTime)
 		int waveOffset = videoDimX/6;
 		int waveStart = 20;
 		float waveLength = 0.2f*(((float)SND_BUFFER_SAMPLE_SIZE/(float)videoDimY)/1);
-		float waveAmplitude = 0.02f*((float)videoDimX/1000.0f);
+		float waveAmplitude = 0.33f*(float)videoDimX;
 		if(color2.Red==0 && color2.Green==0 && color2.Blue==0) {
 			waveOffset = videoDimX/2;
 			waveAmplitude *= 1.5f;
 		}
 		
+		//wave points for every row and the end of the last one
+		float wave[WAVE_MAX_POINTS+1];
+		Vector line[WAVE_MAX_POINTS+1];
+		int wavePoints = (videoDimY < WAVE_MAX_POINTS) ? videoDimY : WAVE_MAX_POINTS;
+		
 		//left wave
-		for(int i=0; i<videoDimY; i++) {
-			int i2 = i+1;
-			int val = soundAnalyzer->getWaveLeft((int)(waveStart + i*waveLength))*waveAmplitude;
-			int val2 = soundAnalyzer->getWaveLeft((int)(waveStart + i2*waveLength))*waveAmplitude;
+		soundAnalyzer->getWave(SND_CHANNEL_LEFT, wavePoints+1, wave, waveStart, waveLength);
+		for(int i=0; i<=wavePoints; i++) {
+			int val = wave[i]*waveAmplitude;
 			if(val > videoDimX) val = videoDimX; if(val < -videoDimX) val = -videoDimX;
-			if(val2 > videoDimX) val2 = videoDimX; if(val2 < -videoDimX) val2 = -videoDimX;
-			
-			int x = (videoDimX-1) - waveOffset;
-			int xOutline1 = x + videoOversample;
-			int xOutline2 = x - videoOversample*2;
-			for(int j=0; j<videoOversample*2; j++) videoDriver->drawLine(Vector((x-j) + val, i), color1, Vector((x-j) + val2, i2), color1);
-			for(int j=0; j<videoOversample; j++) videoDriver->drawLine(Vector((xOutline1-j) + val, i), Color(0,0,0), Vector((xOutline1-j) + val2, i2), Color(0,0,0));
-			for(int j=0; j<videoOversample; j++) videoDriver->drawLine(Vector((xOutline2-j) + val, i), Color(0,0,0), Vector((xOutline2-j) + val2, i2), Color(0,0,0));
+			line[i] = Vector(((videoDimX-1) - waveOffset) - (videoOversample-1) + val, i);
 		}
+		videoDriver->drawPolylineOutlinedAA(line, wavePoints+1, videoOversample*2, color1, videoOversample, Color(0,0,0));
 		
 		//right wave
 		if(color2.Red>0 || color2.Green>0 || color2.Blue>0) {
-			for(int i=0; i<videoDimY; i++) {
-				int i2 = i+1;
-				int val = -soundAnalyzer->getWaveRight((int)(waveStart + i*waveLength))*waveAmplitude;
-				int val2 = -soundAnalyzer->getWaveRight((int)(waveStart + i2*waveLength))*waveAmplitude;
+			soundAnalyzer->getWave(SND_CHANNEL_RIGHT, wavePoints+1, wave, waveStart, waveLength);
+			for(int i=0; i<=wavePoints; i++) {
+				int val = -wave[i]*waveAmplitude;
 				if(val > videoDimX) val = videoDimX; if(val < -videoDimX) val = -videoDimX;
-				if(val2 > videoDimX) val2 = videoDimX; if(val2 < -videoDimX) val2 = -videoDimX;
-				
-				int y = (videoDimY-1)-i;
-				int y2 = (videoDimY-1)-i2;
-				int x = waveOffset;
-				int xOutline1 = x - videoOversample;
-				int xOutline2 = x + videoOversample*2;
-				for(int j=0; j<videoOversample*2; j++) videoDriver->drawLine(Vector((x+j) + val, y), color2, Vector((x+j) + val2, y2), color2);
-				for(int j=0; j<videoOversample; j++) videoDriver->drawLine(Vector((xOutline1+j) + val, y), Color(0,0,0), Vector((xOutline1+j) + val2, y2), Color(0,0,0));
-				for(int j=0; j<videoOversample; j++) videoDriver->drawLine(Vector((xOutline2+j) + val, y), Color(0,0,0), Vector((xOutline2+j) + val2, y2), Color(0,0,0));
+				line[i] = Vector(waveOffset + videoOversample + val, (videoDimY-1)-i);
 			}
+			videoDriver->drawPolylineOutlinedAA(line, wavePoints+1, videoOversample*2, color2, videoOversample, Color(0,0,0));
 		}
 	}
 	
 	//circle spectrum with black outline
 	if(style==STYLE_FULL || style==STYLE_NO_WAVE || style==STYLE_JUST_SPEC) {
-		int specPoints = 100;
+		int specPoints = SPEC_POINTS;
 		int specRadius = fmin((float)videoDimX/2.5f, (float)videoDimY/2.5f);
 		float specAngleOffset = M_PI*0.35f + ((float)rotation/180.0f)*M_PI;
-		float specLength = 1.0f*((float)(SND_BUFFER_SAMPLE_SIZE/2)/(float)specPoints);
-		float specAmplitudeL = 0.13f*((float)specRadius/1000.0f); //outside
-		float specAmplitudeR = 0.09f*((float)specRadius/1000.0f); //inside
+		float specAmplitudeL = 1.56f*(float)specRadius; //outside
+		float specAmplitudeR = 1.08f*(float)specRadius; //inside
 		int specInnerMax = specRadius - (videoOversample);
 		int specOuterMax = videoDimY;
 		
+		//one band per point (the closing point repeats the last band)
+		float bandsL[SPEC_POINTS+1];
+		float bandsR[SPEC_POINTS+1];
+		soundAnalyzer->getBands(SND_CHANNEL_LEFT, specPoints, bandsL);
+		soundAnalyzer->getBands(SND_CHANNEL_RIGHT, specPoints, bandsR);
+		bandsL[specPoints] = bandsL[specPoints-1];
+		bandsR[specPoints] = bandsR[specPoints-1];
+		
 		for(int i=0; i<specPoints; i++) {
 			int i2 = i+1;
 			float angle = ((M_PI*2.0f*i)/specPoints) - specAngleOffset;
 			float angle2 = ((M_PI*2.0f*i2)/specPoints) - specAngleOffset;
-			int valL = soundAnalyzer->getSpecLeft((int)(i*specLength))*specAmplitudeL;
-			int valR = soundAnalyzer->getSpecRight((int)(i*specLength))*specAmplitudeR;
-			int valL2 = soundAnalyzer->getSpecLeft((int)(i2*specLength))*specAmplitudeL;
-			int valR2 = soundAnalyzer->getSpecRight((int)(i2*specLength))*specAmplitudeR;
+			int valL = bandsL[i]*specAmplitudeL;
+			int valR = bandsR[i]*specAmplitudeR;
+			int valL2 = bandsL[i2]*specAmplitudeL;
+			int valR2 = bandsR[i2]*specAmplitudeR;
 			if(valL < videoOversample) valL = videoOversample;
 			if(valL2 < videoOversample) valL2 = videoOversample;
 			if(valL > specOuterMax) valL = specOuterMax; if(valL2 > specOuterMax) valL2 = specOuterMax;
@@ -141,11 +150,11 @@ void CRoundVisualizer::draw(double elapsedTime)
 			
 			//outline
 			for(int j=0; j<videoOversample; j++) {
-				videoDriver->drawLine(center + Vector(cos(angle)*(specRadius+valL+1+j), sin(angle)*(specRadius+valL+1+j)), Color(0,0,0),
+				videoDriver->drawLineAA(center + Vector(cos(angle)*(specRadius+valL+1+j), sin(angle)*(specRadius+valL+1+j)), Color(0,0,0),
 					center + Vector(cos(angle2)*(specRadius+valL2+1+j), sin(angle2)*(specRadius+valL2+1+j)), Color(0,0,0));
 			}
 			
-			//spec
+			//spec (only the rims are smoothed so neighbouring bands meet without seams)
 			Color colorS = color1; 
 			colorS.lerp(color2, 50);
 			colorS.lerp(Color(220,220,220), 90);
@@ -153,10 +162,13 @@ void CRoundVisualizer::draw(double elapsedTime)
 				colorS = color1; 
 				colorS.lerp(Color(220,220,220), 20);
 			}
-			videoDriver->drawQuad(center + Vector(cos(angle)*(specRadius+valL), sin(angle)*(specRadius+valL)), colorS,
-				center + Vector(cos(angle)*(specRadius-valR), sin(angle)*(specRadius-valR)), colorS,
-				center + Vector(cos(angle2)*(specRadius-valR2), sin(angle2)*(specRadius-valR2)), colorS,
-				center + Vector(cos(angle2)*(specRadius+valL2), sin(angle2)*(specRadius+valL2)), colorS);
+			Vector spec[4];
+			Color specColors[4] = {colorS, colorS, colorS, colorS};
+			spec[0] = center + Vector(cos(angle)*(specRadius+valL), sin(angle)*(specRadius+valL));
+			spec[1] = center + Vector(cos(angle)*(specRadius-valR), sin(angle)*(specRadius-valR));
+			spec[2] = center + Vector(cos(angle2)*(specRadius-valR2), sin(angle2)*(specRadius-valR2));
+			spec[3] = center + Vector(cos(angle2)*(specRadius+valL2), sin(angle2)*(specRadius+valL2));
+			videoDriver->drawPolygonAA(spec, specColors, 4, (1 << 1) | (1 << 3));
 		}
 	}
 	
@@ -168,23 +180,20 @@ void CRoundVisualizer::draw(double elapsedTime)
 		if(style==STYLE_NO_SPEC) accRadius = 1.5f*(float)accRadius;
 		Vector center = Vector(videoDimX/2, videoDimY/2);
 		
-		//outline
-		for(int i=0; i<videoOversample; i++) {
-			videoDriver->drawLine(center + Vector(cos(accRotate)*(accRadius+1+i), sin(accRotate)*(accRadius+1+i)), Color(0,0,0), 
-				center + Vector(cos(accRotate+(M_PI*0.5f))*(accRadius+1+i), sin(accRotate+(M_PI*0.5f))*(accRadius+1+i)), Color(0,0,0));
-			videoDriver->drawLine(center + Vector(cos(accRotate+(M_PI*0.5f))*(accRadius+1+i), sin(accRotate+(M_PI*0.5f))*(accRadius+1+i)), Color(0,0,0), 
-				center + Vector(cos(accRotate+(M_PI*1.0f))*(accRadius+1+i), sin(accRotate+(M_PI*1.0f))*(accRadius+1+i)), Color(0,0,0));
-			videoDriver->drawLine(center + Vector(cos(accRotate+(M_PI*1.0f))*(accRadius+1+i), sin(accRotate+(M_PI*1.0f))*(accRadius+1+i)), Color(0,0,0), 
-				center + Vector(cos(accRotate+(M_PI*1.5f))*(accRadius+1+i), sin(accRotate+(M_PI*1.5f))*(accRadius+1+i)), Color(0,0,0));
-			videoDriver->drawLine(center + Vector(cos(accRotate+(M_PI*1.5f))*(accRadius+1+i), sin(accRotate+(M_PI*1.5f))*(accRadius+1+i)), Color(0,0,0), 
-				center + Vector(cos(accRotate+(M_PI*2.0f))*(accRadius+1+i), sin(accRotate+(M_PI*2.0f))*(accRadius+1+i)), Color(0,0,0));
+		//outline (a larger black square behind the accent)
+		Vector outline[4];
+		Vector accent[4];
+		Color outlineColors[4] = {Color(0,0,0), Color(0,0,0), Color(0,0,0), Color(0,0,0)};
+		Color accentColors[4] = {color2, color1, color2, color1};
+		for(int i=0; i<4; i++) {
+			float angle = accRotate + (M_PI*0.5f)*i;
+			outline[i] = center + Vector(cos(angle)*(accRadius+videoOversample+1), sin(angle)*(accRadius+videoOversample+1));
+			accent[i] = center + Vector(cos(angle)*(accRadius), sin(angle)*(accRadius));
 		}
+		videoDriver->drawPolygonAA(outline, outlineColors, 4);
 		
 		//accent
-		videoDriver->drawQuad(center + Vector(cos(accRotate)*(accRadius), sin(accRotate)*(accRadius)), color2,
-			center + Vector(cos(accRotate+(M_PI*0.5f))*(accRadius), sin(accRotate+(M_PI*0.5f))*(accRadius)), color1,
-			center + Vector(cos(accRotate+(M_PI*1.0f))*(accRadius), sin(accRotate+(M_PI*1.0f))*(accRadius)), color2,
-			center + Vector(cos(accRotate+(M_PI*1.5f))*(accRadius), sin(accRotate+(M_PI*1.5f))*(accRadius)), color1);
+		videoDriver->drawPolygonAA(accent, accentColors, 4);
 	}
 }
 
@@ -217,6 +226,18 @@ int CRoundVisualizer::getStyle()
 	return style;
 }
 
+//! Gets the sound analysis features the current style uses
+int CRoundVisualizer::getFeatures()
+{
+	int features = SND_FEATURE_LEVELS;
+	if(style==STYLE_FULL || style==STYLE_NO_SPEC) {
+		features |= SND_FEATURE_WAVE_LEFT;
+		if(color2.Red>0 || color2.Green>0 || color2.Blue>0) features |= SND_FEATURE_WAVE_RIGHT;
+	}
+	if(style==STYLE_FULL || style==STYLE_NO_WAVE || style==STYLE_JUST_SPEC) features |= SND_FEATURE_BANDS;
+	return features;
+}
+
 //! Clears all resources of the visualizer
 void CRoundVisualizer::clear()
 {
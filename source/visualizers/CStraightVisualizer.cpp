@@ -14,6 +14,12 @@
 #define STYLE_NO_SPEC 2
 #define NUM_STYLES 3
 
+#define MAX_POINTS 1024
+
+//time constants of the old per frame smoothing at 60fps, -(1/60)/ln(1-factor) (wave 0.6, spectrum 0.3 also carried by bands and volume)
+#define WAVE_TIME_CONSTANT 0.018f
+#define SPEC_TIME_CONSTANT 0.047f
+
 //! Main Constructor
 CStraightVisualizer::CStraightVisualizer(CVideoDriver* vd, CSoundAnalyzer* sa, int r) :
 	videoDriver(vd), soundAnalyzer(sa), color1(0,0,0), color2(0,0,0), style(0), rotation(r)
@@ -32,17 +38,23 @@ void CStraightVisualizer::setup()
 	videoDriver->setRotation(rotation);
 	soundAnalyzer->setSamplingFrequency(SND_DEFAULT_SAMPLE_FREQUENCY);
 	soundAnalyzer->setWaveLPF(0.3f);
-	soundAnalyzer->setWaveTimeSmooth(0.6f);
 	soundAnalyzer->setSpecSmoothPass(8);
-	soundAnalyzer->setSpecTimeSmooth(0.3f);
+	soundAnalyzer->setWaveTimeConstants(WAVE_TIME_CONSTANT, WAVE_TIME_CONSTANT);
+	soundAnalyzer->setSpecTimeConstants(SPEC_TIME_CONSTANT, SPEC_TIME_CONSTANT);
+	soundAnalyzer->setBandTimeConstants(SPEC_TIME_CONSTANT, SPEC_TIME_CONSTANT);
+	soundAnalyzer->setVUTimeConstants(SPEC_TIME_CONSTANT, SPEC_TIME_CONSTANT);
+	soundAnalyzer->setAGC(true);
+	soundAnalyzer->setAGCTarget(-23.0f);
+	soundAnalyzer->setAGCTimeConstants(0.5f, 5.0f);
+	soundAnalyzer->setBandLayout(BAND_LAYOUT_LOG, videoDriver->getDimension().X);
 }
 
 //! Draws the visualizer
 void CStraightVisualizer::draw(double elapsedTime)
 {
 	//compute basic values
-	float intensity = (float)(soundAnalyzer->getVURight()+soundAnalyzer->getVULeft())/6000.0f;
-	float bassIntensity = (float)(soundAnalyzer->getBassRight()+soundAnalyzer->getBassLeft())/24000.0f;
+	float intensity = (soundAnalyzer->getVURightNorm()+soundAnalyzer->getVULeftNorm())/2.0f;
+	float bassIntensity = (soundAnalyzer->getBassRightNorm()+soundAnalyzer->getBassLeftNorm())/2.0f;
 	float cappedIntensity = (intensity > 1.0f) ? 1.0f : intensity;
 	int videoOversample = videoDriver->getOversample();
 	int videoDimX = videoDriver->getDimension().X;
@@ -70,7 +82,7 @@ void CStraightVisualizer::draw(double elapsedTime)
 		int waveOffset = videoDimY/6;
 		int waveStart = 20;
 		float waveLength = 0.4f*(((float)SND_BUFFER_SAMPLE_SIZE/(float)videoDimX)/1);
-		float waveAmplitude = 0.02f*((float)videoDimY/1000.0f);
+		float waveAmplitude = 0.33f*(float)videoDimY;
 		if(style==STYLE_NO_SPEC) {
 			waveOffset = videoDimY/3;
 		}
@@ -79,48 +91,43 @@ void CStraightVisualizer::draw(double elapsedTime)
 			waveAmplitude *= 1.5f;
 		}
 		
+		//wave points for every column and the end of the last one
+		float wave[MAX_POINTS+1];
+		Vector line[MAX_POINTS+1];
+		int wavePoints = (videoDimX < MAX_POINTS) ? videoDimX : MAX_POINTS;
+		
 		//left wave
-		for(int i=0; i<videoDimX; i++) {
-			int i2 = i+1;
-			int val = soundAnalyzer->getWaveLeft((int)(waveStart + i*waveLength))*waveAmplitude;
-			int val2 = soundAnalyzer->getWaveLeft((int)(waveStart + i2*waveLength))*waveAmplitude;
+		soundAnalyzer->getWave(SND_CHANNEL_LEFT, wavePoints+1, wave, waveStart, waveLength);
+		for(int i=0; i<=wavePoints; i++) {
+			int val = wave[i]*waveAmplitude;
 			if(val > videoDimX) val = videoDimX; if(val < -videoDimX) val = -videoDimX;
-			if(val2 > videoDimX) val2 = videoDimX; if(val2 < -videoDimX) val2 = -videoDimX;
-			
-			int y = (videoDimY-1) - waveOffset;
-			int yOutline1 = y + videoOversample;
-			int yOutline2 = y - videoOversample*2;
-			for(int j=0; j<videoOversample*2; j++) videoDriver->drawLine(Vector(i, (y-j) + val), color1, Vector(i2, (y-j) + val2), color1);
-			for(int j=0; j<videoOversample; j++) videoDriver->drawLine(Vector(i, (yOutline1-j) + val), Color(0,0,0), Vector(i2, (yOutline1-j) + val2), Color(0,0,0));
-			for(int j=0; j<videoOversample; j++) videoDriver->drawLine(Vector(i, (yOutline2-j) + val), Color(0,0,0), Vector(i2, (yOutline2-j) + val2), Color(0,0,0));
+			line[i] = Vector(i, ((videoDimY-1) - waveOffset) - (videoOversample-1) + val);
 		}
+		videoDriver->drawPolylineOutlinedAA(line, wavePoints+1, videoOversample*2, color1, videoOversample, Color(0,0,0));
 		
 		//right wave
 		if(color2.Red>0 || color2.Green>0 || color2.Blue>0) {
-			for(int i=0; i<videoDimX; i++) {
-				int i2 = i+1;
-				int val = -soundAnalyzer->getWaveRight((int)(waveStart + i*waveLength))*waveAmplitude;
-				int val2 = -soundAnalyzer->getWaveRight((int)(waveStart + i2*waveLength))*waveAmplitude;
+			soundAnalyzer->getWave(SND_CHANNEL_RIGHT, wavePoints+1, wave, waveStart, waveLength);
+			for(int i=0; i<=wavePoints; i++) {
+				int val = -wave[i]*waveAmplitude;
 				if(val > videoDimX) val = videoDimX; if(val < -videoDimX) val = -videoDimX;
-				if(val2 > videoDimX) val2 = videoDimX; if(val2 < -videoDimX) val2 = -videoDimX;
-				
-				int y = waveOffset;
-				int yOutline1 = y - videoOversample;
-				int yOutline2 = y + videoOversample*2;
-				for(int j=0; j<videoOversample*2; j++) videoDriver->drawLine(Vector(i, (y+j) + val), color2, Vector(i2, (y+j) + val2), color2);
-				for(int j=0; j<videoOversample; j++) videoDriver->drawLine(Vector(i, (yOutline1+j) + val), Color(0,0,0), Vector(i2, (yOutline1+j) + val2), Color(0,0,0));
-				for(int j=0; j<videoOversample; j++) videoDriver->drawLine(Vector(i, (yOutline2+j) + val), Color(0,0,0), Vector(i2, (yOutline2+j) + val2), Color(0,0,0));
+				line[i] = Vector(i, waveOffset + videoOversample + val);
 			}
+			videoDriver->drawPolylineOutlinedAA(line, wavePoints+1, videoOversample*2, color2, videoOversample, Color(0,0,0));
 		}
 	}
 	
 	//spectrum with black outline
 	if(style==STYLE_FULL || style==STYLE_NO_WAVE) {
-		float specLength = 1.0f*((float)(SND_BUFFER_SAMPLE_SIZE/2)/(float)videoDimX);
-		float specAmplitude = 0.05f*((float)videoDimY/1000.0f);
-		for(int i=0; i<videoDimX; i++) {
-			int valL = soundAnalyzer->getSpecLeft((int)(i*specLength))*specAmplitude;
-			int valR = soundAnalyzer->getSpecRight((int)(i*specLength))*specAmplitude;
+		float specAmplitude = 0.6f*(float)videoDimY;
+		float bandsL[MAX_POINTS];
+		float bandsR[MAX_POINTS];
+		int specPoints = (videoDimX < MAX_POINTS) ? videoDimX : MAX_POINTS;
+		soundAnalyzer->getBands(SND_CHANNEL_LEFT, specPoints, bandsL);
+		soundAnalyzer->getBands(SND_CHANNEL_RIGHT, specPoints, bandsR);
+		for(int i=0; i<specPoints; i++) {
+			int valL = bandsL[i]*specAmplitude;
+			int valR = bandsR[i]*specAmplitude;
 			if(valL < videoOversample) valL = videoOversample; if(valL > videoDimY) valL = videoDimY;
 			if(valR < videoOversample) valR = videoOversample; if(valR > videoDimY) valR = videoDimY;
 			int yCenter = videoDimY/2;
@@ -173,6 +180,18 @@ int CStraightVisualizer::getStyle()
 	return style;
 }
 
+//! Gets the sound analysis features the current style uses
+int CStraightVisualizer::getFeatures()
+{
+	int features = SND_FEATURE_LEVELS;
+	if(style==STYLE_FULL || style==STYLE_NO_SPEC) {
+		features |= SND_FEATURE_WAVE_LEFT;
+		if(color2.Red>0 || color2.Green>0 || color2.Blue>0) features |= SND_FEATURE_WAVE_RIGHT;
+	}
+	if(style==STYLE_FULL || style==STYLE_NO_WAVE) features |= SND_FEATURE_BANDS;
+	return features;
+}
+
 //! Clears all resources of the visualizer
 void CStraightVisualizer::clear()
 {
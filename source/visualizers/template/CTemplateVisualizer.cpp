@@ -40,9 +40,17 @@ void CTemplateVisualizer::setup()
 	videoDriver->setRotation(0);
 	soundAnalyzer->setSamplingFrequency(SND_DEFAULT_SAMPLE_FREQUENCY);
 	soundAnalyzer->setWaveLPF(SND_DEFAULT_WAVE_LP_FILTER);
-	soundAnalyzer->setWaveTimeSmooth(SND_DEFAULT_WAVE_TIME_SMOOTH);
 	soundAnalyzer->setSpecSmoothPass(SND_DEFAULT_SPEC_SMOOTH_PASS);
-	soundAnalyzer->setSpecTimeSmooth(SND_DEFAULT_SPEC_TIME_SMOOTH);
+	soundAnalyzer->setWaveTimeConstants(SND_DEFAULT_WAVE_ATTACK, SND_DEFAULT_WAVE_RELEASE);
+	soundAnalyzer->setSpecTimeConstants(SND_DEFAULT_SPEC_ATTACK, SND_DEFAULT_SPEC_RELEASE);
+	soundAnalyzer->setBandTimeConstants(SND_DEFAULT_BAND_ATTACK, SND_DEFAULT_BAND_RELEASE);
+	soundAnalyzer->setVUTimeConstants(SND_DEFAULT_VU_ATTACK, SND_DEFAULT_VU_RELEASE);
+	soundAnalyzer->setAGC(SND_DEFAULT_AGC);
+	soundAnalyzer->setAGCTarget(SND_DEFAULT_AGC_TARGET);
+	soundAnalyzer->setAGCTimeConstants(SND_DEFAULT_AGC_ATTACK, SND_DEFAULT_AGC_RELEASE);
+	soundAnalyzer->setBandLayout(SND_DEFAULT_BAND_LAYOUT, SND_DEFAULT_NUM_BANDS);
+	soundAnalyzer->setHistoryLayout(SND_DEFAULT_HISTORY_LAYOUT, SND_DEFAULT_HISTORY_BANDS);
+	soundAnalyzer->setHistoryBudget(SND_DEFAULT_HISTORY_BUDGET);
 }
 
 //! Draws the visualizer
@@ -51,10 +59,18 @@ void CTemplateVisualizer::draw(double elapsedTime)
 	/*** this method draws the visualizer ***/
 	
 	/*** It's recomended to do your sound anlysis variable computation first ***/
-	//float intensity = (float)(soundAnalyzer->getVURight()+soundAnalyzer->getVULeft())/6000.0f;
-	//float trebIntensity = (float)(soundAnalyzer->getTrebRight()+soundAnalyzer->getTrebLeft())/24000.0f;
-	//float midIntensity = (float)(soundAnalyzer->getMidRight()+soundAnalyzer->getMidLeft())/24000.0f;
-	//float bassIntensity = (float)(soundAnalyzer->getBassRight()+soundAnalyzer->getBassLeft())/24000.0f;
+	//float intensity = (soundAnalyzer->getVURightNorm()+soundAnalyzer->getVULeftNorm())/2.0f;
+	//float trebIntensity = (soundAnalyzer->getTrebRightNorm()+soundAnalyzer->getTrebLeftNorm())/2.0f;
+	//float midIntensity = (soundAnalyzer->getMidRightNorm()+soundAnalyzer->getMidLeftNorm())/2.0f;
+	//float bassIntensity = (soundAnalyzer->getBassRightNorm()+soundAnalyzer->getBassLeftNorm())/2.0f;
+	//float kickIntensity = soundAnalyzer->getEnvelopeNorm(FBK_BAND_KICK); //only a few ms behind the audio
+	//bool beat = soundAnalyzer->getBeat();
+	//float beatPhase = soundAnalyzer->getBeatPhase();
+	//int pitchClass = soundAnalyzer->getChromaPeak();
+	//float pitchStrength = soundAnalyzer->getChroma(pitchClass);
+	//float pastBand = soundAnalyzer->getHistoryLeftNorm(age, band); //age 0 is the newest frame
+	//float spectrum[64]; soundAnalyzer->getSpectrum(SND_CHANNEL_LEFT, 64, spectrum, SND_SPACING_LOG); //fills all points at once
+	//float barHeight = soundAnalyzer->getSpecLeftDB(bin)*videoDimY; //dB range set with setDBRange is already mapped to 0.0-1.0
 	//int videoOversample = videoDriver->getOversample();
 	//int videoDimX = videoDriver->getDimension().X;
 	//int videoDimY = videoDriver->getDimension().Y;
@@ -99,6 +115,13 @@ int CTemplateVisualizer::getStyle()
 	return style;
 }
 
+//! Gets the sound analysis features the current style uses
+int CTemplateVisualizer::getFeatures()
+{
+	/*** return only the SND_FEATURE_* flags your draw code reads so the rest of the analysis can be skipped ***/
+	return SND_FEATURE_ALL;
+}
+
 //! Clears all resources of the visualizer
 void CTemplateVisualizer::clear()
 {
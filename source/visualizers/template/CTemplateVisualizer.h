@@ -39,6 +39,9 @@ public:
 	//! Gets the visualizer style
 	int getStyle();
 	
+	//! Gets the sound analysis features the current style uses
+	int getFeatures();
+	
 	//! Clears all resources of the visualizer
 	void clear();
 	
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Checks the fixed point analysis path against the float one at 0 and 8 smoothing passes
+# (spectrum and bands within 5% of the float value + 0.2% of the frame peak + 2, waves within +/-5)
+# usage: fixedpoint.sh <visualsound-analyze> <test-signal> <work directory>
+ANALYZE=$1
+SIGNAL=$2
+WORKDIR=$3
+
+$SIGNAL $WORKDIR/fixedpoint.wav || exit 2
+status=0
+for passes in 0 8; do
+	echo "fixed point, $passes smoothing passes"
+	for sections in sb w; do
+		$ANALYZE -p $passes -s $sections $WORKDIR/fixedpoint.wav $WORKDIR/fixedpoint-float.csv 2> /dev/null || exit 2
+		$ANALYZE -x -p $passes -s $sections $WORKDIR/fixedpoint.wav $WORKDIR/fixedpoint-fixed.csv 2> /dev/null || exit 2
+		if [ $sections = w ]; then
+			$ANALYZE -c -d 5 $WORKDIR/fixedpoint-float.csv $WORKDIR/fixedpoint-fixed.csv || status=1
+		else
+			$ANALYZE -c -d 2 -t 0.05 -f 0.002 $WORKDIR/fixedpoint-float.csv $WORKDIR/fixedpoint-fixed.csv || status=1
+		fi
+	done
+done
+exit $status
@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------------------
+// Title:   Spectrum Smoothing Test
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "smo.h"
+
+#define NUM_BINS 256
+#define MAX_PASSES 40
+#define NUM_FRAMES 6
+
+#define FLOAT_TOLERANCE 0.02    //float sums and the dropped kernel tail
+#define FIXED_TOLERANCE 4.0     //rounded output and up to one q15 unit per kernel tap
+
+#define MAX_REPORT 16
+
+//functions
+void fillFrame(int frame, double* data);
+void smoothIterative(const double* in, double* out, int passes);
+
+//main
+int main(int argc, char** argv)
+{
+	int failures = 0;
+	double maxFloatDiff = 0;
+	double maxFixedDiff = 0;
+	for(int passes=0; passes<=MAX_PASSES; passes++) {
+		float kernel[SMO_MAX_PASSES+1];
+		int kernelQ15[SMO_MAX_PASSES+1];
+		int size = smo_buildKernel(passes, kernel, kernelQ15);
+		for(int f=0; f<NUM_FRAMES; f++) {
+			double frame[NUM_BINS];
+			double reference[NUM_BINS];
+			fillFrame(f, frame);
+			smoothIterative(frame, reference, passes);
+
+			//the one pass smoothers against the iterative 3-tap passes (every bin, so the reflected edges are covered)
+			float floatIn[NUM_BINS];
+			float floatOut[NUM_BINS];
+			int fixedIn[NUM_BINS];
+			int fixedOut[NUM_BINS];
+			for(int i=0; i<NUM_BINS; i++) {
+				floatIn[i] = frame[i];
+				fixedIn[i] = frame[i];
+			}
+			smo_smooth(floatIn, floatOut, NUM_BINS, kernel, size);
+			smo_smoothFixed(fixedIn, fixedOut, NUM_BINS, kernelQ15, size);
+			for(int i=0; i<NUM_BINS; i++) {
+				double floatDiff = fabs(floatOut[i] - reference[i]);
+				double fixedDiff = fabs(fixedOut[i] - reference[i]);
+				if(floatDiff > maxFloatDiff) maxFloatDiff = floatDiff;
+				if(fixedDiff > maxFixedDiff) maxFixedDiff = fixedDiff;
+				if(floatDiff <= FLOAT_TOLERANCE && fixedDiff <= FIXED_TOLERANCE) continue;
+				if(failures++ < MAX_REPORT) {
+					printf("%d passes, frame %d, bin %d: iterative %.4f, float %.4f, fixed %d\n", passes, f, i, reference[i], floatOut[i], fixedOut[i]);
+				}
+			}
+		}
+	}
+	if(failures > MAX_REPORT) printf("... and %d more bins\n", failures - MAX_REPORT);
+	printf("%s: 0-%d passes, max diff %g (float) %g (fixed), %d out of tolerance\n", failures ? "FAIL" : "PASS", MAX_PASSES, maxFloatDiff, maxFixedDiff, failures);
+	return failures ? 1 : 0;
+}
+
+//fills a magnitude frame (full scale spikes on and next to the edge bins, a step, a ramp and noise)
+void fillFrame(int frame, double* data)
+{
+	unsigned int seed = 12345 + frame;
+	for(int i=0; i<NUM_BINS; i++) {
+		seed = seed*1103515245 + 12345;
+		switch(frame) {
+			case 0: data[i] = (i == 0 || i == NUM_BINS-1) ? 32767 : 0; break;
+			case 1: data[i] = (i == 1 || i == NUM_BINS-2) ? 32767 : 0; break;
+			case 2: data[i] = (i < NUM_BINS/2) ? 32767 : 0; break;
+			case 3: data[i] = 32767; break;
+			case 4: data[i] = (i*32767)/(NUM_BINS-1); break;
+			default: data[i] = (seed >> 8) % 32768; break;
+		}
+	}
+}
+
+//runs the original smoothing, one 3-tap box pass at a time (zero outside the frame)
+void smoothIterative(const double* in, double* out, int passes)
+{
+	double buffer[2][NUM_BINS];
+	for(int i=0; i<NUM_BINS; i++) buffer[0][i] = in[i];
+	for(int p=0; p<passes; p++) {
+		int from = p%2;
+		int to = (p+1)%2;
+		buffer[to][0] = (buffer[from][0]+buffer[from][1])/3.0;
+		buffer[to][NUM_BINS-1] = (buffer[from][NUM_BINS-1]+buffer[from][NUM_BINS-2])/3.0;
+		for(int j=1; j<NUM_BINS-1; j++) buffer[to][j] = (buffer[from][j-1]+buffer[from][j]+buffer[from][j+1])/3.0;
+	}
+	for(int i=0; i<NUM_BINS; i++) out[i] = buffer[passes%2][i];
+}
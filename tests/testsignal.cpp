@@ -0,0 +1,100 @@
+//-----------------------------------------------------------------------------------------
+// Title:   Test Signal
+// Program: VisualSound
+// Authors: Stephen Monn
+//-----------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <math.h>
+
+#define WAV_RATE 48000
+#define WAV_SEGMENT_SECONDS 0.5
+#define PI 3.141592653589793
+
+//one segment of the test signal per channel (sine amplitudes/frequencies and noise amplitude)
+typedef struct {
+	double sineAmp[2];
+	double sineFreq[2];
+	double noiseAmp;
+} Segment;
+
+//sines, noise and mixtures from quiet to full scale
+static const Segment segments[] = {
+	{{100, 0}, {440, 0}, 0},
+	{{1000, 0}, {1000, 0}, 0},
+	{{8000, 0}, {63, 0}, 0},
+	{{32000, 0}, {5000, 0}, 0},
+	{{0, 0}, {0, 0}, 100},
+	{{0, 0}, {0, 0}, 4000},
+	{{0, 0}, {0, 0}, 20000},
+	{{12000, 6000}, {110, 2500}, 0},
+	{{16000, 8000}, {220, 9000}, 4000},
+	{{300, 200}, {3000, 12000}, 200},
+};
+
+//functions
+int writeWav(const char* fileName);
+
+//main
+int main(int argc, char** argv)
+{
+	if(argc != 2) {
+		fprintf(stderr, "usage: test-signal <output.wav>\n");
+		return 2;
+	}
+	return writeWav(argv[1]);
+}
+
+//writes the test signal as a 16 bit stereo wav file
+int writeWav(const char* fileName)
+{
+	FILE* file = fopen(fileName, "wb");
+	if(!file) {
+		fprintf(stderr, "Failed to open output file: %s\n", fileName);
+		return 2;
+	}
+	int numSegments = sizeof(segments)/sizeof(segments[0]);
+	int segmentFrames = WAV_RATE*WAV_SEGMENT_SECONDS;
+	unsigned int dataSize = numSegments*segmentFrames*4;
+	unsigned int chunkSize = 36 + dataSize;
+	unsigned int formatSize = 16;
+	unsigned short format = 1;
+	unsigned short channels = 2;
+	unsigned int rate = WAV_RATE;
+	unsigned int byteRate = WAV_RATE*4;
+	unsigned short blockAlign = 4;
+	unsigned short bits = 16;
+	fwrite("RIFF", 1, 4, file);
+	fwrite(&chunkSize, 4, 1, file);
+	fwrite("WAVEfmt ", 1, 8, file);
+	fwrite(&formatSize, 4, 1, file);
+	fwrite(&format, 2, 1, file);
+	fwrite(&channels, 2, 1, file);
+	fwrite(&rate, 4, 1, file);
+	fwrite(&byteRate, 4, 1, file);
+	fwrite(&blockAlign, 2, 1, file);
+	fwrite(&bits, 2, 1, file);
+	fwrite("data", 1, 4, file);
+	fwrite(&dataSize, 4, 1, file);
+
+	//fixed seed so every run analyzes the same samples
+	unsigned int seed = 12345;
+	for(int s=0; s<numSegments; s++) {
+		const Segment* segment = &segments[s];
+		for(int i=0; i<segmentFrames; i++) {
+			double t = (double)i/WAV_RATE;
+			short frame[2];
+			for(int c=0; c<2; c++) {
+				double value = 0;
+				for(int k=0; k<2; k++) value += segment->sineAmp[k]*sin(2*PI*segment->sineFreq[k]*(t + c*0.001));
+				seed = seed*1103515245 + 12345;
+				value += segment->noiseAmp*((double)((seed >> 8) & 0xFFFF)/32768.0 - 1.0);
+				if(value > 32767) value = 32767;
+				if(value < -32768) value = -32768;
+				frame[c] = (short)lround(value);
+			}
+			fwrite(frame, 2, 2, file);
+		}
+	}
+	fclose(file);
+	return 0;
+}